@@ -1,33 +1,63 @@
+#include "IncrementalLexer.h"
 #include "Lexer.h"
+#include "StreamingLexer.h"
+#include "TokenWriter.h"
+#include <atomic>
+#include <cerrno>
 #include <iostream>
-#include <fstream>
-#include <cassert>
+#include <sstream>
+#include <thread>
+#include <vector>
+#include <fcntl.h>
+#include <spawn.h>
+#include <sys/wait.h>
+#include <unistd.h>
 
 using namespace std;
 
-std::stringstream getExpected(const std::string& lexerPath, const std::string& fileName) {
-    std::system((lexerPath + " " + fileName + " > actual.txt").c_str());
-    ifstream actualFile("actual.txt");
-    stringstream actualResult;
-    actualResult << actualFile.rdbuf();
-    actualFile.close();
-    std::remove("actual.txt");
+// Runs the reference lexer on the file and collects its standard output through a pipe
+std::string getExpected(const std::string& lexerPath, const std::string& fileName) {
+    int fds[2];
+    // close-on-exec, so lexers spawned concurrently by other threads don't inherit the pipe
+    if (pipe2(fds, O_CLOEXEC) != 0) throw std::runtime_error("Failed to create a pipe");
 
-    return actualResult;
-}
-
-std::stringstream getActual(const std::string& fileName) {
-    ifstream file(fileName);
-    if (!file.is_open()) {
-        throw std::runtime_error("File " + fileName + " wasn't found");
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    posix_spawn_file_actions_adddup2(&actions, fds[1], STDOUT_FILENO);
+    char* arguments[] = {const_cast<char*>(lexerPath.c_str()), const_cast<char*>(fileName.c_str()), nullptr};
+    pid_t pid;
+    auto spawned = posix_spawn(&pid, lexerPath.c_str(), &actions, nullptr, arguments, environ);
+    posix_spawn_file_actions_destroy(&actions);
+    close(fds[1]);
+    if (spawned != 0) {
+        close(fds[0]);
+        throw std::runtime_error("Failed to run " + lexerPath);
     }
 
-    stringstream buffer;
-    buffer << file.rdbuf();
-    file.close();
+    std::string output;
+    char buffer[64 * 1024];
+    ssize_t count;
+    while ((count = read(fds[0], buffer, sizeof(buffer))) != 0) {
+        if (count < 0) {
+            if (errno == EINTR) continue;
+            break;
+        }
+        output.append(buffer, count);
+    }
+    close(fds[0]);
+    int status;
+    while (waitpid(pid, &status, 0) < 0 && errno == EINTR) {}
+    // the output of a lexer that crashed or failed may be cut short, so it can't be expected
+    if (!WIFEXITED(status)) throw std::runtime_error(lexerPath + " was killed by signal " + std::to_string(WTERMSIG(status)));
+    if (WEXITSTATUS(status) != 0) {
+        throw std::runtime_error(lexerPath + " exited with status " + std::to_string(WEXITSTATUS(status)));
+    }
+    return output;
+}
 
+std::stringstream getActual(const std::string& fileName) {
     stringstream expectedResult;
-    auto lexer = Lexer(buffer.str());
+    auto lexer = Lexer(Source::fromFile(fileName));
     expectedResult << "#name \"" << fileName << "\"" << endl;
     while (lexer.hasNext()) {
         expectedResult << lexer.next().toString() << endl;
@@ -35,24 +65,275 @@ std::stringstream getActual(const std::string& fileName) {
     return expectedResult;
 }
 
-int main(int argc, char** argv) {
-    auto lexerPath = std::string(argv[1]);
-    auto fileName = std::string(argv[2]);
+// Deferred line tracking must resolve every token to the line the eager lexer reports
+bool checkDeferredLines(const std::string& fileName, std::ostream& log) {
+    auto eager = Lexer(Source::fromFile(fileName));
+    auto deferred = Lexer(Source::fromFile(fileName), Lexer::LineTracking::DEFERRED);
+    while (eager.hasNext() && deferred.hasNext()) {
+        auto expected = eager.next();
+        auto actual = deferred.next();
+        if (deferred.lineOf(actual) != expected.getLine()) {
+            log << "Deferred line " << deferred.lineOf(actual) << " differs from " << expected.toString() << endl;
+            return false;
+        }
+    }
+    return !eager.hasNext() && !deferred.hasNext();
+}
 
-    auto expectedResult = getExpected(lexerPath, fileName);
-    auto actualResult = getActual(fileName);
+// Lexing in tiny chunks puts every token, string and comment delimiter across a chunk boundary
+bool checkStreaming(const std::string& fileName, std::size_t chunkSize, std::ostream& log) {
+    auto fd = open(fileName.c_str(), O_RDONLY);
+    if (fd < 0) throw std::runtime_error("File " + fileName + " wasn't found");
 
+    auto lexer = Lexer(Source::fromFile(fileName));
+    auto streaming = StreamingLexer(fd, chunkSize);
+    auto equal = true;
+    while (equal && lexer.hasNext() && streaming.hasNext()) {
+        auto expected = lexer.next();
+        auto actual = streaming.next();
+        if (actual.toString() != expected.toString() || actual.getOffset() != expected.getOffset()) {
+            log << "Streaming with chunks of " << chunkSize << " gave " << actual.toString()
+                 << " instead of " << expected.toString() << endl;
+            equal = false;
+        }
+    }
+    equal = equal && !lexer.hasNext() && !streaming.hasNext();
+    close(fd);
+    return equal;
+}
+
+// Decodes the binary stream of the file and compares every record with the token it was written from
+bool checkBinary(const std::string& fileName, std::ostream& log) {
+    std::vector<Token> tokens;
+    auto writer = TokenWriter(TokenWriter::Format::BINARY);
+    auto lexer = Lexer(Source::fromFile(fileName));
+    writer.writeName(fileName);
+    while (lexer.hasNext()) {
+        tokens.push_back(lexer.next());
+        writer.write(tokens.back());
+    }
+    auto stream = writer.release();
+
+    std::size_t position = 0;
+    auto readVarint = [&]() {
+        std::uint64_t value = 0;
+        for (int shift = 0; position < stream.size(); shift += 7) {
+            auto byte = static_cast<unsigned char>(stream[position++]);
+            value |= std::uint64_t(byte & 0x7F) << shift;
+            if (!(byte & 0x80)) break;
+        }
+        return value;
+    };
+    auto readText = [&]() {
+        auto length = readVarint();
+        auto text = stream.substr(position, length);
+        position += length;
+        return text;
+    };
+
+    if (static_cast<unsigned char>(stream[position]) != TokenStream::SECTION) return false;
+    position += 1 + sizeof(TokenStream::MAGIC) + 1;
+    readText();
+    std::vector<std::string> interned[TokenStream::SPACE_COUNT];
+    std::size_t line = 0;
+    for (auto& token : tokens) {
+        auto kind = static_cast<unsigned char>(stream[position++]);
+        line += readVarint();
+        auto expectedKind = token.getKind() == Token::Kind::ATOM
+                            ? static_cast<unsigned char>(token.getLexeme().front())
+                            : TokenStream::KIND_BASE + TokenStream::parserCode(token.getKind()) - TokenStream::FIRST_PARSER_CODE;
+        std::string lexeme(token.getLexeme());
+        auto space = token.getKind() == Token::Kind::INT_CONST ? TokenStream::INTEGERS
+                     : token.getKind() == Token::Kind::STR_CONST ? TokenStream::STRINGS
+                     : TokenStream::IDENTIFIERS;
+        if (token.getKind() == Token::Kind::TYPEID || token.getKind() == Token::Kind::OBJECTID
+            || token.getKind() == Token::Kind::INT_CONST || token.getKind() == Token::Kind::STR_CONST) {
+            auto id = readVarint();
+            if (id == interned[space].size()) interned[space].push_back(readText());
+            // strings are stored unescaped, so only identifiers and integers are compared
+            if (id >= interned[space].size() || (space != TokenStream::STRINGS && interned[space][id] != lexeme)) return false;
+        } else if (token.getKind() == Token::Kind::BOOL_CONST) {
+            if (stream[position++] != (lexeme == "true")) return false;
+        } else if (token.getKind() == Token::Kind::ERROR) {
+            readText();
+        }
+        if (kind != expectedKind || line != token.getLine()) {
+            log << "Binary record of " << token.toString() << " differs" << endl;
+            return false;
+        }
+    }
+    return position == stream.size();
+}
+
+// Every edit must leave the same tokens as lexing the edited text from scratch. Comment and string
+// delimiters are inserted and removed again at a few places spread over the file.
+bool checkIncremental(const std::string& fileName, std::ostream& log) {
+    auto text = std::string(Source::fromFile(fileName).text());
+    auto incremental = IncrementalLexer(text);
+    for (std::string_view inserted : {"(*", "*)", "\"", "--", "a", "\n", "\\"}) {
+        for (std::size_t part = 0; part < 4; part++) {
+            auto offset = text.size() * part / 4;
+            incremental.apply({offset, 0, inserted});
+            auto edited = text;
+            edited.insert(offset, inserted);
+            for (auto round = 0; round < 2; round++) {
+                auto lexer = Lexer(edited);
+                for (auto& token : incremental.tokens()) {
+                    auto expected = lexer.hasNext() ? lexer.next().toString() : "";
+                    if (token.toString() != expected) {
+                        log << "Inserting " << inserted << " at " << offset << " gave " << token.toString()
+                             << " instead of " << expected << endl;
+                        return false;
+                    }
+                }
+                if (lexer.hasNext() || incremental.text() != edited) return false;
+                if (round == 0) {
+                    // and the same once the edit is undone
+                    incremental.apply({offset, inserted.size(), ""});
+                    edited = text;
+                }
+            }
+        }
+    }
+    return true;
+}
+
+// The arrays filled in one pass must hold the tokens next() returns, with either line tracking
+bool checkTokenizeAll(const std::string& fileName, Lexer::LineTracking lines, std::ostream& log) {
+    auto lexer = Lexer(Source::fromFile(fileName));
+    auto all = Lexer(Source::fromFile(fileName), lines);
+    auto buffer = all.tokenizeAll();
+    std::size_t i = 0;
+    for (; lexer.hasNext(); i++) {
+        auto expected = lexer.next();
+        if (i == buffer.size() || buffer.token(i).toString() != expected.toString()
+            || buffer.offsets[i] != expected.getOffset() || buffer.lengths[i] != expected.getLength()) {
+            log << "Token " << i << " of tokenizeAll() differs from " << expected.toString() << endl;
+            return false;
+        }
+    }
+    return i == buffer.size();
+}
+
+// Formats pushed tokens the way Token::toString does
+class FormattingHandler : public TokenHandler {
+public:
+    void onToken(Token::Kind kind, std::string_view lexeme, std::size_t offset, std::size_t length,
+                 std::size_t line) override {
+        lines.emplace_back();
+        Token::format(lines.back(), kind, lexeme, line);
+        spans.emplace_back(offset, length);
+    }
+
+    void onError(std::string_view message, std::size_t offset, std::size_t length, std::size_t line) override {
+        onToken(Token::Kind::ERROR, message, offset, length, line);
+    }
+
+    std::vector<std::string> lines;
+    std::vector<std::pair<std::size_t, std::size_t>> spans;
+};
+
+// The push API must report the tokens next() returns
+bool checkHandler(const std::string& fileName, std::ostream& log) {
+    auto lexer = Lexer(Source::fromFile(fileName));
+    auto pushing = Lexer(Source::fromFile(fileName));
+    FormattingHandler handler;
+    pushing.lex(handler);
+    std::size_t i = 0;
+    for (; lexer.hasNext(); i++) {
+        auto expected = lexer.next();
+        if (i == handler.lines.size() || handler.lines[i] != expected.toString()
+            || handler.spans[i] != std::make_pair(expected.getOffset(), expected.getLength())) {
+            log << "Token " << i << " pushed by lex() differs from " << expected.toString() << endl;
+            return false;
+        }
+    }
+    return i == handler.lines.size();
+}
+
+// Compares the output of the reference lexer with ours line by line, up to the shorter of both
+bool compareWithReference(const std::string& expected, std::stringstream& actualResult, std::ostream& log, bool echo) {
+    std::stringstream expectedResult(expected);
     std::string actual;
     std::string expect;
     while (std::getline(expectedResult, expect, '\n') && std::getline(actualResult, actual, '\n')) {
         if (actual == expect) {
-            cout << actual << endl;
+            if (echo) log << actual << endl;
+        } else {
+            log << "Lines are not equal." << endl;
+            log << "Expected:" << endl << expect << endl;
+            log << "Actual:" << endl << actual << endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+bool checkFile(const std::string& lexerPath, const std::string& fileName, std::ostream& log, bool echo) {
+    auto expected = getExpected(lexerPath, fileName);
+    auto actualResult = getActual(fileName);
+
+    // the checks log the token that differs, if there is one, and the name of the check follows
+    auto failed = [&log](const char* check) {
+        log << check << " check failed" << endl;
+        return false;
+    };
+    if (!checkDeferredLines(fileName, log)) return failed("Deferred line");
+    if (!checkStreaming(fileName, 1, log) || !checkStreaming(fileName, 7, log)) return failed("Streaming");
+    if (!checkBinary(fileName, log)) return failed("Binary stream");
+    if (!checkIncremental(fileName, log)) return failed("Incremental");
+    if (!checkTokenizeAll(fileName, Lexer::LineTracking::EAGER, log)) return failed("tokenizeAll()");
+    if (!checkTokenizeAll(fileName, Lexer::LineTracking::DEFERRED, log)) return failed("Deferred tokenizeAll()");
+    if (!checkHandler(fileName, log)) return failed("Handler");
+
+    return compareWithReference(expected, actualResult, log, echo);
+}
+
+// lexer_test reference_lexer file.cool...
+// A single file is checked the way every test used to be, several files are checked concurrently and
+// only failures are reported.
+int main(int argc, char** argv) {
+    if (argc < 3) {
+        cerr << "Usage: lexer_test reference_lexer file.cool..." << endl;
+        return 1;
+    }
+    auto lexerPath = std::string(argv[1]);
+    std::vector<std::string> fileNames(argv + 2, argv + argc);
+    auto echo = fileNames.size() == 1;
+
+    std::vector<std::string> logs(fileNames.size());
+    std::vector<char> passed(fileNames.size(), false);
+    std::atomic<std::size_t> nextFile{0};
+    auto work = [&]() {
+        for (auto i = nextFile++; i < fileNames.size(); i = nextFile++) {
+            std::stringstream log;
+            try {
+                passed[i] = checkFile(lexerPath, fileNames[i], log, echo);
+            } catch (const std::exception& e) {
+                log << e.what() << endl;
+            }
+            logs[i] = log.str();
+        }
+    };
+
+    std::vector<std::thread> workers;
+    auto threadCount = std::min<std::size_t>(std::max(1u, std::thread::hardware_concurrency()), fileNames.size());
+    for (std::size_t i = 0; i < threadCount; i++) {
+        workers.emplace_back(work);
+    }
+    for (auto& worker : workers) {
+        worker.join();
+    }
+
+    auto failures = 0;
+    for (std::size_t i = 0; i < fileNames.size(); i++) {
+        if (passed[i]) {
+            cout << logs[i];
         } else {
-            cerr << "Lines are not equal." << endl;
-            cerr << "Expected:" << endl << expect << endl;
-            cerr << "Actual:" << endl << actual << endl;
-            return 1;
+            failures++;
+            cerr << (echo ? "" : fileNames[i] + ":\n") << logs[i];
         }
     }
-    return 0;
-}
\ No newline at end of file
+    if (!echo) cout << fileNames.size() - failures << " of " << fileNames.size() << " files passed" << endl;
+    return failures == 0 ? 0 : 1;
+}
@@ -13,9 +13,40 @@
 
 
 // constructors' functions
+// The copy is built in an arena of its own, so it outlives the original.
 Program program_class::copy_Program()
 {
-   return new program_class(classes->copy_list());
+   Arena *fresh = new Arena;
+   Arena *a = set_ast_arena(fresh);
+   Program copy = new program_class(classes->copy_list());
+   set_ast_arena(a);
+   copy->set_arena(fresh);
+   return copy;
+}
+
+
+// The program frees the arena, and the nodes in it, when it is deleted.
+// The program node itself is not in the arena.
+void program_class::set_arena(Arena *a)
+{
+   arena = a;
+}
+
+
+program_class::~program_class()
+{
+   if (current_ast_arena == arena)
+      set_ast_arena(NULL);
+   delete arena;
+}
+
+
+void program_class::print_stats(ostream& stream)
+{
+   if (arena) {
+      stream << "ast: ";
+      arena->print_stats(stream) << "\n";
+   }
 }
 
 
@@ -436,77 +467,77 @@ void object_class::dump(ostream& stream, int n)
 // interfaces used by Bison
 Classes nil_Classes()
 {
-   return new nil_node<Class_>();
+   return list_node<Class_>::nil();
 }
 
 Classes single_Classes(Class_ e)
 {
-   return new single_list_node<Class_>(e);
+   return list_node<Class_>::single(e);
 }
 
 Classes append_Classes(Classes p1, Classes p2)
 {
-   return new append_node<Class_>(p1, p2);
+   return list_node<Class_>::append(p1, p2);
 }
 
 Features nil_Features()
 {
-   return new nil_node<Feature>();
+   return list_node<Feature>::nil();
 }
 
 Features single_Features(Feature e)
 {
-   return new single_list_node<Feature>(e);
+   return list_node<Feature>::single(e);
 }
 
 Features append_Features(Features p1, Features p2)
 {
-   return new append_node<Feature>(p1, p2);
+   return list_node<Feature>::append(p1, p2);
 }
 
 Formals nil_Formals()
 {
-   return new nil_node<Formal>();
+   return list_node<Formal>::nil();
 }
 
 Formals single_Formals(Formal e)
 {
-   return new single_list_node<Formal>(e);
+   return list_node<Formal>::single(e);
 }
 
 Formals append_Formals(Formals p1, Formals p2)
 {
-   return new append_node<Formal>(p1, p2);
+   return list_node<Formal>::append(p1, p2);
 }
 
 Expressions nil_Expressions()
 {
-   return new nil_node<Expression>();
+   return list_node<Expression>::nil();
 }
 
 Expressions single_Expressions(Expression e)
 {
-   return new single_list_node<Expression>(e);
+   return list_node<Expression>::single(e);
 }
 
 Expressions append_Expressions(Expressions p1, Expressions p2)
 {
-   return new append_node<Expression>(p1, p2);
+   return list_node<Expression>::append(p1, p2);
 }
 
 Cases nil_Cases()
 {
-   return new nil_node<Case>();
+   return list_node<Case>::nil();
 }
 
 Cases single_Cases(Case e)
 {
-   return new single_list_node<Case>(e);
+   return list_node<Case>::single(e);
 }
 
 Cases append_Cases(Cases p1, Cases p2)
 {
-   return new append_node<Case>(p1, p2);
+   return list_node<Case>::append(p1, p2);
 }
 
 Program program(Classes classes)
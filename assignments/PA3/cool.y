@@ -77,6 +77,11 @@
     void yyerror(char *s);        /*  defined below; called for each parse error */
     extern int yylex();           /*  the entry point to the lexer  */
     
+    /* tokens come through token-reader.cc, which also accepts binary streams */
+    #undef yylex
+    #define yylex read_token
+    extern int read_token();
+    
     /************************************************************************/
     /*                DONT CHANGE ANYTHING IN THIS SECTION                  */
     
@@ -29,18 +29,27 @@ extern Program ast_root;	 // the AST produced by the parse
 char *curr_filename = "<stdin>";
 
 extern int omerrs;             // a count of lex and parse errors
+extern int memory_stats;       // print the memory used by the phase
 
 extern int cool_yyparse();
 void handle_flags(int argc, char *argv[]);
 
 int main(int argc, char *argv[]) {
     handle_flags(argc, argv);
+    // the tree is built in an arena of its own, which the program frees
+    Arena *arena = new Arena;
+    set_ast_arena(arena);
     cool_yyparse();
     if (omerrs != 0) {
 	cerr << "Compilation halted due to lex and parse errors\n";
 	exit(1);
     }
+    ast_root->set_arena(arena);
     ast_root->dump_with_types(cout,0);
+    if (memory_stats) {
+	print_stringtab_stats(cerr);
+	ast_root->print_stats(cerr);
+    }
     return 0;
 }
 
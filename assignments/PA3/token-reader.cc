@@ -0,0 +1,163 @@
+//
+// See copyright.h for copyright notice and limitation of liability
+// and disclaimer of warranty provisions.
+//
+#include "copyright.h"
+
+//////////////////////////////////////////////////////////////////////////////
+//
+//  token-reader.cc
+//
+//  Front end of the parser: reads the tokens from token_file either as
+//  text, with the flex token lexer, or as the binary stream written by
+//  "cool_lexer --format=binary" (see include/PA2/TokenStream.h for the
+//  layout).  The format is detected from the first byte of the input.
+//
+//////////////////////////////////////////////////////////////////////////////
+
+#include <stdio.h>
+#include <string>
+#include <vector>
+#include "cool-io.h"
+#include "cool-parse.h"
+#include "stringtab.h"
+#include "utilities.h"
+#include "TokenStreamFormat.h"  // shared with the writer in PA2
+
+using namespace TokenStream;
+
+// the writer maps Token::Kind to these codes
+static_assert(FIRST_PARSER_CODE == CLASS, "token codes of cool-parse.h changed");
+static_assert(ERROR_CODE == ERROR, "token codes of cool-parse.h changed");
+static_assert(LET_STMT_CODE == LET_STMT, "token codes of cool-parse.h changed");
+
+extern FILE *token_file;
+extern int curr_lineno;
+extern char *curr_filename;
+
+extern int cool_yylex();
+
+enum Format { UNKNOWN, TEXT, BINARY };
+static Format format = UNKNOWN;
+
+// Symbols interned in the current section, indexed by their id
+static std::vector<Symbol> interned[SPACE_COUNT];
+static int line;
+static std::string text;
+
+static int read_byte()
+{
+  int c = getc(token_file);
+  if (c == EOF)
+    fatal_error("unexpected end of the binary token stream\n");
+  return c;
+}
+
+static unsigned long read_varint()
+{
+  unsigned long value = 0;
+  for (int shift = 0; ; shift += 7) {
+    int c = read_byte();
+    value |= (unsigned long) (c & 0x7F) << shift;
+    if (!(c & 0x80))
+      return value;
+  }
+}
+
+// Reads varint(length) and the bytes into text
+static void read_text()
+{
+  text.resize(read_varint());
+  if (!text.empty() && fread(&text[0], 1, text.size(), token_file) != text.size())
+    fatal_error("unexpected end of the binary token stream\n");
+}
+
+// The parser keeps the file name and error messages, so they are kept in the
+// string table rather than copied for every section and error
+static char *keep(std::string &s)
+{
+  return stringtable.add_string(&s[0], s.size())->get_string();
+}
+
+static void read_section()
+{
+  for (unsigned i = 0; i < sizeof(MAGIC); i++)
+    if (read_byte() != MAGIC[i])
+      fatal_error("not a binary token stream\n");
+  if (read_byte() != VERSION)
+    fatal_error("unsupported version of the binary token stream\n");
+
+  read_text();
+  curr_filename = keep(text);
+  line = 0;
+  for (int i = 0; i < SPACE_COUNT; i++)
+    interned[i].clear();
+}
+
+static Symbol read_symbol(Space space)
+{
+  std::vector<Symbol> &symbols = interned[space];
+  unsigned long id = read_varint();
+  if (id < symbols.size())
+    return symbols[id];
+  if (id != symbols.size())
+    fatal_error("undefined string in the binary token stream\n");
+
+  read_text();
+  char *s = const_cast<char *>(text.c_str());
+  Symbol symbol;
+  switch (space) {
+  case IDENTIFIERS: symbol = idtable.add_string(s, text.size()); break;
+  case INTEGERS:    symbol = inttable.add_string(s, text.size()); break;
+  default:          symbol = stringtable.add_string(s, text.size()); break;
+  }
+  symbols.push_back(symbol);
+  return symbol;
+}
+
+static int read_binary_token()
+{
+  int c;
+  while ((c = getc(token_file)) == SECTION)
+    read_section();
+  if (c == EOF)
+    return 0;
+
+  line += read_varint();
+  curr_lineno = line;
+  if (c < KIND_BASE)
+    return c;
+
+  int token = FIRST_PARSER_CODE + c - KIND_BASE;
+  switch (token) {
+  case TYPEID:
+  case OBJECTID:
+    cool_yylval.symbol = read_symbol(IDENTIFIERS);
+    break;
+  case INT_CONST:
+    cool_yylval.symbol = read_symbol(INTEGERS);
+    break;
+  case STR_CONST:
+    cool_yylval.symbol = read_symbol(STRINGS);
+    break;
+  case BOOL_CONST:
+    cool_yylval.boolean = read_byte();
+    break;
+  case ERROR:
+    read_text();
+    cool_yylval.error_msg = keep(text);
+    break;
+  }
+  return token;
+}
+
+int read_token()
+{
+  if (format == UNKNOWN) {
+    int c = getc(token_file);
+    if (c != EOF)
+      ungetc(c, token_file);
+    format = c == SECTION ? BINARY : TEXT;
+  }
+  return format == BINARY ? read_binary_token() : cool_yylex();
+}
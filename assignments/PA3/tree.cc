@@ -18,6 +18,23 @@
 /* line number to assign to the current node being constructed */
 int node_lineno = 1;
 
+/* arena to allocate the current node being constructed from */
+Arena *current_ast_arena = NULL;
+
+///////////////////////////////////////////////////////////////////////////
+//
+// set_ast_arena
+//
+// make a the current AST arena and return the one it replaces
+//
+///////////////////////////////////////////////////////////////////////////
+Arena *set_ast_arena(Arena *a)
+{
+    Arena *arena = current_ast_arena;
+    current_ast_arena = a;
+    return arena;
+}
+
 ///////////////////////////////////////////////////////////////////////////
 //
 // tree_node::tree_node
@@ -18,11 +18,7 @@ template class StringTable<IdEntry>;
 template class StringTable<StringEntry>;
 template class StringTable<IntEntry>;
 
-Entry::Entry(char *s, int l, int i) : len(l), index(i) {
-  str = new char [len+1];
-  strncpy(str, s, len);
-  str[len] = '\0';
-}
+Entry::Entry(char *s, int l, int i) : str(s), len(l), index(i) { }
 
 int Entry::equal_string(char *string, int length) const
 {
@@ -77,3 +73,10 @@ IntEntry::IntEntry(char *s, int l, int i) : Entry(s,l,i) { }
 IdTable idtable;
 IntTable inttable;
 StrTable stringtable;
+
+void print_stringtab_stats(ostream& s)
+{
+  idtable.print_stats(s,"idtable");
+  inttable.print_stats(s,"inttable");
+  stringtable.print_stats(s,"stringtable");
+}
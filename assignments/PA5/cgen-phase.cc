@@ -12,6 +12,7 @@ FILE *ast_file = stdin;       // we read the AST from standard input
 extern int ast_yyparse(void); // entry point to the AST parser
 
 int cool_yydebug;     // not used, but needed to link with handle_flags
+extern int memory_stats;      // print the memory used by the phase
 char *curr_filename;
 
 void handle_flags(int argc, char *argv[]);
@@ -34,7 +35,11 @@ int main(int argc, char *argv[]) {
   // Don't touch the output file until we know that earlier phases of the
   // compiler have succeeded.
   //
+  // the tree, and the nodes cgen adds, are in an arena the program frees
+  Arena *arena = new Arena;
+  set_ast_arena(arena);
   ast_yyparse();
+  ast_root->set_arena(arena);
 
   if (out_filename) {
       ofstream s(out_filename);
@@ -46,5 +51,9 @@ int main(int argc, char *argv[]) {
   } else {
       ast_root->cgen(cout);
   }
+  if (memory_stats) {
+    print_stringtab_stats(cerr);
+    ast_root->print_stats(cerr);
+  }
 }
 
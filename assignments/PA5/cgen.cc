@@ -27,6 +27,7 @@
 
 extern void emit_string_constant(ostream& str, char *s);
 extern int cgen_debug;
+extern int memory_stats;
 
 //
 // Three symbols from the semantic analyzer (semant.cc) are used.
@@ -413,12 +414,12 @@ void StringEntry::code_def(ostream& s, int stringclasstag)
 //
 // StrTable::code_string
 // Generate a string object definition for every string constant in the 
-// stringtable.
+// stringtable, newest first.
 //
 void StrTable::code_string_table(ostream& s, int stringclasstag)
 {  
-  for (List<StringEntry> *l = tbl; l; l = l->tl())
-    l->hd()->code_def(s,stringclasstag);
+  for (int i = published - 1; i >= 0; i--)
+    lookup(i)->code_def(s,stringclasstag);
 }
 
 //
@@ -454,12 +455,12 @@ void IntEntry::code_def(ostream &s, int intclasstag)
 //
 // IntTable::code_string_table
 // Generate an Int object definition for every Int constant in the
-// inttable.
+// inttable, newest first.
 //
 void IntTable::code_string_table(ostream &s, int intclasstag)
 {
-  for (List<IntEntry> *l = tbl; l; l = l->tl())
-    l->hd()->code_def(s,intclasstag);
+  for (int i = published - 1; i >= 0; i--)
+    lookup(i)->code_def(s,intclasstag);
 }
 
 
@@ -630,6 +631,7 @@ CgenClassTable::CgenClassTable(Classes classes, ostream& s) : nds(NULL) , str(s)
    build_inheritance_tree();
 
    code();
+   if (memory_stats) print_stats(cerr,"class table");
    exitscope();
 }
 
@@ -14,7 +14,7 @@ typedef CgenClassTable *CgenClassTableP;
 class CgenNode;
 typedef CgenNode *CgenNodeP;
 
-class CgenClassTable : public SymbolTable<Symbol,CgenNode> {
+class CgenClassTable : public HashedSymbolTable<Symbol,CgenNode> {
 private:
    List<CgenNode> *nds;
    ostream& str;
@@ -21,6 +21,8 @@ class Program_class : public tree_node {
 public:
    tree_node *copy()		 { return copy_Program(); }
    virtual Program copy_Program() = 0;
+   virtual void set_arena(Arena *a) = 0;
+   virtual void print_stats(ostream& stream) = 0;
 
 #ifdef Program_EXTRAS
    Program_EXTRAS
@@ -129,11 +131,18 @@ typedef Cases_class *Cases;
 class program_class : public Program_class {
 public:
    Classes classes;
+   Arena *arena;               // freed with the program, NULL if none
 public:
    program_class(Classes a1) {
       classes = a1;
+      arena = NULL;
    }
+   ~program_class();
+   void set_arena(Arena *a);
+   void *operator new(size_t size) { return ::operator new(size); }
+   void operator delete(void *p) { ::operator delete(p); }
    Program copy_Program();
+   void print_stats(ostream& stream);
    void dump(ostream& stream, int n);
 
 #ifdef Program_SHARED_EXTRAS
@@ -0,0 +1,97 @@
+#include "Lexer.h"
+#include "Utils.h"
+#include <chrono>
+#include <iostream>
+#include <vector>
+
+using namespace std;
+
+// Character classification as it was before the lookup table, kept as the baseline
+namespace legacy {
+    static bool isDigit(char c) {
+        return c >= '0' && c <= '9';
+    }
+
+    static bool isAlpha(char c) {
+        return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z');
+    }
+
+    static bool isAlphaOdDigitOrUnderscore(char c) {
+        return isAlpha(c) || isDigit(c) || c == '_';
+    }
+
+    static bool isWhitespace(char c) {
+        return c == ' ' || c == '\f' || c == '\r' || c == '\t' || c == '\v' || c == '\n';
+    }
+}
+
+struct Counts {
+    std::size_t digits = 0;
+    std::size_t identifierChars = 0;
+    std::size_t whitespaces = 0;
+
+    bool operator==(const Counts& other) const {
+        return digits == other.digits && identifierChars == other.identifierChars && whitespaces == other.whitespaces;
+    }
+};
+
+template<typename Classify>
+static double measure(std::string_view text, std::size_t rounds, Counts& counts, Classify&& classify) {
+    auto start = chrono::steady_clock::now();
+    for (std::size_t round = 0; round < rounds; round++) {
+        counts = Counts();
+        for (auto c : text) classify(c, counts);
+    }
+    auto elapsed = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    return double(rounds * text.size()) / elapsed / (1024 * 1024);
+}
+
+static double measureLexer(std::string_view text, std::size_t rounds) {
+    std::size_t tokens = 0;
+    auto start = chrono::steady_clock::now();
+    for (std::size_t round = 0; round < rounds; round++) {
+        auto lexer = Lexer(Source::borrow(text));
+        while (lexer.hasNext()) {
+            lexer.next();
+            tokens++;
+        }
+    }
+    auto elapsed = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    if (tokens == 0) cerr << "No tokens found" << endl;
+    return double(rounds * text.size()) / elapsed / (1024 * 1024);
+}
+
+int main(int argc, char** argv) {
+    if (argc == 1) {
+        cerr << "Usage: charclass_bench file.cl..." << endl;
+        return 1;
+    }
+
+    std::string text;
+    for (int i = 1; i < argc; i++) {
+        text += Source::fromFile(argv[i]).text();
+    }
+
+    auto rounds = std::max<std::size_t>(1, (256 << 20) / std::max<std::size_t>(1, text.size()));
+    Counts legacyCounts, tableCounts;
+    auto legacyThroughput = measure(text, rounds, legacyCounts, [](char c, Counts& counts) {
+        counts.digits += legacy::isDigit(c);
+        counts.identifierChars += legacy::isAlphaOdDigitOrUnderscore(c);
+        counts.whitespaces += legacy::isWhitespace(c);
+    });
+    auto tableThroughput = measure(text, rounds, tableCounts, [](char c, Counts& counts) {
+        counts.digits += isDigit(c);
+        counts.identifierChars += isAlphaOdDigitOrUnderscore(c);
+        counts.whitespaces += isWhitespace(c);
+    });
+    if (!(legacyCounts == tableCounts)) {
+        cerr << "Classifications differ" << endl;
+        return 1;
+    }
+
+    cout << text.size() << " bytes x " << rounds << " rounds" << endl;
+    cout << "comparisons: " << legacyThroughput << " MB/s" << endl;
+    cout << "table:       " << tableThroughput << " MB/s" << endl;
+    cout << "lexer:       " << measureLexer(text, std::max<std::size_t>(1, rounds / 64)) << " MB/s" << endl;
+    return 0;
+}
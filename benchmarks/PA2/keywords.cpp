@@ -0,0 +1,99 @@
+#include "Lexer.h"
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <vector>
+
+using namespace std;
+
+// getKeywordType as it was before the length-bucketed switch, kept as the baseline
+static std::string toLowerCase(std::string_view str) {
+    auto copy = std::string(str);
+    std::transform(copy.begin(), copy.end(), copy.begin(), [](unsigned char c){ return std::tolower(c); });
+    return copy;
+}
+
+static Token::Kind legacyGetKeywordType(std::string_view str) {
+    auto lowercaseStr = toLowerCase(str);
+    if (lowercaseStr == "class") return Token::Kind::CLASS;
+    if (lowercaseStr == "else") return Token::Kind::ELSE;
+    if (lowercaseStr == "fi") return Token::Kind::FI;
+    if (lowercaseStr == "if") return Token::Kind::IF;
+    if (lowercaseStr == "in") return Token::Kind::IN;
+    if (lowercaseStr == "inherits") return Token::Kind::INHERITS;
+    if (lowercaseStr == "let") return Token::Kind::LET;
+    if (lowercaseStr == "loop") return Token::Kind::LOOP;
+    if (lowercaseStr == "pool") return Token::Kind::POOL;
+    if (lowercaseStr == "then") return Token::Kind::THEN;
+    if (lowercaseStr == "while") return Token::Kind::WHILE;
+    if (lowercaseStr == "case") return Token::Kind::CASE;
+    if (lowercaseStr == "esac") return Token::Kind::ESAC;
+    if (lowercaseStr == "of") return Token::Kind::OF;
+    if (lowercaseStr == "new") return Token::Kind::NEW;
+    if (lowercaseStr == "isvoid") return Token::Kind::ISVOID;
+    if (lowercaseStr == "not") return Token::Kind::NOT;
+    if (lowercaseStr == "true" || lowercaseStr == "false") return Token::Kind::BOOL_CONST;
+    return Token::Kind::ERROR;
+}
+
+static std::vector<std::string_view> collectIdentifiers(std::string_view text) {
+    std::vector<std::string_view> identifiers;
+    std::size_t i = 0;
+    while (i < text.size()) {
+        if (!isalpha((unsigned char) text[i])) {
+            i++;
+            continue;
+        }
+        auto begin = i;
+        while (i < text.size() && (isalnum((unsigned char) text[i]) || text[i] == '_')) i++;
+        identifiers.push_back(text.substr(begin, i - begin));
+    }
+    return identifiers;
+}
+
+template<typename F>
+static double measure(const std::vector<std::string_view>& identifiers, std::size_t rounds, F&& getKeywordType) {
+    std::size_t checksum = 0;
+    auto start = chrono::steady_clock::now();
+    for (std::size_t round = 0; round < rounds; round++) {
+        for (auto identifier : identifiers) checksum += getKeywordType(identifier);
+    }
+    auto elapsed = chrono::duration<double, nano>(chrono::steady_clock::now() - start).count();
+    if (checksum == 1) cerr << ""; // keeps the loop from being optimized away
+    return elapsed / double(rounds * identifiers.size());
+}
+
+int main(int argc, char** argv) {
+    if (argc == 1) {
+        cerr << "Usage: keyword_bench file.cl..." << endl;
+        return 1;
+    }
+
+    std::vector<Source> sources;
+    std::vector<std::string_view> identifiers;
+    for (int i = 1; i < argc; i++) {
+        sources.push_back(Source::fromFile(argv[i]));
+        auto found = collectIdentifiers(sources.back().text());
+        identifiers.insert(identifiers.end(), found.begin(), found.end());
+    }
+    if (identifiers.empty()) {
+        cerr << "No identifiers found" << endl;
+        return 1;
+    }
+
+    for (auto identifier : identifiers) {
+        if (Lexer::getKeywordType(identifier) != legacyGetKeywordType(identifier)) {
+            cerr << "Mismatch on " << identifier << endl;
+            return 1;
+        }
+    }
+
+    auto rounds = std::max<std::size_t>(1, 20'000'000 / identifiers.size());
+    auto legacy = measure(identifiers, rounds, legacyGetKeywordType);
+    auto bucketed = measure(identifiers, rounds, Lexer::getKeywordType);
+    cout << identifiers.size() << " identifiers x " << rounds << " rounds" << endl;
+    cout << "legacy:   " << legacy << " ns/identifier" << endl;
+    cout << "bucketed: " << bucketed << " ns/identifier" << endl;
+    cout << "speedup:  " << legacy / bucketed << "x" << endl;
+    return 0;
+}
@@ -0,0 +1,305 @@
+#include "Lexer.h"
+#include "Scan.h"
+#include "StreamingLexer.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <vector>
+#include <unistd.h>
+
+using namespace std;
+
+// Relative weights of the constructs a synthetic corpus is made of
+struct Mix {
+    std::string name;
+    unsigned identifiers;
+    unsigned strings;
+    unsigned escapes;
+    unsigned comments;
+    unsigned integers;
+};
+
+static const std::vector<Mix> MIXES = {
+    {"mixed", 8, 1, 1, 1, 2},
+    {"identifiers", 1, 0, 0, 0, 0},
+    {"strings", 0, 1, 0, 0, 0},
+    {"escapes", 0, 0, 1, 0, 0},
+    {"comments", 0, 0, 0, 1, 0},
+    {"integers", 0, 0, 0, 0, 1},
+};
+
+// Generates lexically valid COOL of about `size` bytes. The seed is fixed, so corpora are the same on every run
+class CorpusGenerator {
+public:
+    explicit CorpusGenerator(const Mix& mix)
+        : choice({double(mix.identifiers), double(mix.strings), double(mix.escapes), double(mix.comments),
+                  double(mix.integers)}) {}
+
+    std::string generate(std::size_t size) {
+        std::string text;
+        text.reserve(size + 2048);
+        std::size_t lineStart = 0;
+        while (text.size() < size) {
+            switch (choice(engine)) {
+                case 0: identifier(text); break;
+                case 1: longString(text); break;
+                case 2: escapedString(text); break;
+                case 3: nestedComment(text); break;
+                default: integer(text); break;
+            }
+            // tokens are separated by an operator now and then, lines are kept at about 80 columns
+            if (engine() % 4 == 0) text += OPERATORS[engine() % OPERATORS.size()];
+            if (text.size() - lineStart > 80) {
+                text += '\n';
+                lineStart = text.size();
+            } else {
+                text += ' ';
+            }
+        }
+        return text;
+    }
+
+private:
+    inline static const std::vector<std::string> KEYWORDS = {
+        "class", "else", "fi", "if", "in", "inherits", "let", "loop", "pool", "then", "while", "case", "esac",
+        "of", "new", "isvoid", "not", "true", "false", "SELF_TYPE", "self"
+    };
+    inline static const std::vector<std::string> OPERATORS = {
+        "<-", "<=", "=>", "+", "-", "*", "/", "<", "=", "~", ".", "@", ",", ";", ":", "(", ")", "{", "}"
+    };
+
+    void identifier(std::string& text) {
+        if (engine() % 5 == 0) {
+            text += KEYWORDS[engine() % KEYWORDS.size()];
+            return;
+        }
+        static const char letters[] = "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ";
+        static const char rest[] = "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789_";
+        text += letters[engine() % (sizeof(letters) - 1)];
+        for (auto length = engine() % 16; length > 0; length--) text += rest[engine() % (sizeof(rest) - 1)];
+    }
+
+    // printable characters only, shorter than the 1024 characters a string constant may have
+    void longString(std::string& text) {
+        text += '"';
+        for (auto length = 64 + engine() % 900; length > 0; length--) {
+            auto c = static_cast<char>(' ' + engine() % 95);
+            text += c == '"' || c == '\\' ? 'x' : c;
+        }
+        text += '"';
+    }
+
+    void escapedString(std::string& text) {
+        static const std::vector<std::string> escapes = {"\\n", "\\t", "\\b", "\\f", "\\\"", "\\\\", "\\q", "\\\n", "\t"};
+        text += '"';
+        for (auto parts = 1 + engine() % 24; parts > 0; parts--) {
+            if (engine() % 2 == 0) {
+                text += escapes[engine() % escapes.size()];
+            } else {
+                text += "text ";
+            }
+        }
+        text += '"';
+    }
+
+    void nestedComment(std::string& text) {
+        if (engine() % 4 == 0) {
+            text += "-- a line comment with * and ( in it\n";
+            return;
+        }
+        auto depth = 1 + engine() % 4;
+        for (std::size_t i = 0; i < depth; i++) text += "(* level ";
+        text += "with *stars* and (parentheses)\n spanning lines ";
+        for (std::size_t i = 0; i < depth; i++) text += " *)";
+    }
+
+    void integer(std::string& text) {
+        for (auto digits = 1 + engine() % 10; digits > 0; digits--) text += static_cast<char>('0' + engine() % 10);
+    }
+
+    std::mt19937 engine{2024};
+    std::discrete_distribution<int> choice;
+};
+
+// A text to lex, also written to a temporary file for the lexers that read a file descriptor
+struct Input {
+    std::string_view text;
+    int fd;
+};
+
+// A way of running the lexer over a whole text, returns the number of tokens
+struct Path {
+    std::string name;
+    std::function<std::size_t(const Input&)> run;
+};
+
+static std::size_t lexWithNext(std::string_view text, Lexer::LineTracking lines) {
+    std::size_t tokens = 0;
+    auto lexer = Lexer(Source::borrow(text), lines);
+    while (lexer.hasNext()) {
+        lexer.next();
+        tokens++;
+    }
+    return tokens;
+}
+
+class CountingHandler : public TokenHandler {
+public:
+    void onToken(Token::Kind, std::string_view, std::size_t, std::size_t, std::size_t) override { tokens++; }
+    void onError(std::string_view, std::size_t, std::size_t, std::size_t) override { tokens++; }
+
+    std::size_t tokens = 0;
+};
+
+static std::size_t lexStreaming(const Input& input) {
+    lseek(input.fd, 0, SEEK_SET);
+    std::size_t tokens = 0;
+    auto lexer = StreamingLexer(input.fd);
+    while (lexer.hasNext()) {
+        lexer.next();
+        tokens++;
+    }
+    return tokens;
+}
+
+static const std::vector<Path> PATHS = {
+    {"next()", [](const Input& input) { return lexWithNext(input.text, Lexer::LineTracking::EAGER); }},
+    {"next() deferred", [](const Input& input) { return lexWithNext(input.text, Lexer::LineTracking::DEFERRED); }},
+    {"tokenizeAll()", [](const Input& input) { return Lexer(Source::borrow(input.text)).tokenizeAll().size(); }},
+    {"tokenizeAll() deferred", [](const Input& input) {
+        return Lexer(Source::borrow(input.text), Lexer::LineTracking::DEFERRED).tokenizeAll().size();
+    }},
+    {"lex() handler", [](const Input& input) {
+        CountingHandler handler;
+        Lexer(Source::borrow(input.text)).lex(handler);
+        return handler.tokens;
+    }},
+    {"StreamingLexer", lexStreaming},
+};
+
+// Repeats every path for at least minimumSeconds and prints its throughput
+static bool benchmark(const std::string& name, std::string_view text, double minimumSeconds) {
+    // a temporary file stands in for stdin, it is written once per text and closed when the text is done
+    auto file = std::unique_ptr<std::FILE, int (*)(std::FILE*)>(std::tmpfile(), std::fclose);
+    if (!file || std::fwrite(text.data(), 1, text.size(), file.get()) != text.size() || std::fflush(file.get()) != 0) {
+        throw std::runtime_error("Failed to write a temporary file");
+    }
+    auto input = Input{text, fileno(file.get())};
+
+    std::size_t expectedTokens = 0;
+    for (auto& path : PATHS) {
+        std::size_t rounds = 0;
+        std::size_t tokens = 0;
+        auto start = chrono::steady_clock::now();
+        double elapsed;
+        do {
+            tokens = path.run(input);
+            rounds++;
+            elapsed = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        } while (elapsed < minimumSeconds);
+
+        if (expectedTokens == 0) expectedTokens = tokens;
+        if (tokens != expectedTokens) {
+            cerr << path.name << " found " << tokens << " tokens in " << name << " instead of " << expectedTokens << endl;
+            return false;
+        }
+        cout << left << setw(28) << name << setw(24) << path.name << right << fixed << setprecision(1)
+             << setw(10) << double(rounds * text.size()) / elapsed / (1024 * 1024) << " MB/s"
+             << setw(10) << double(rounds * tokens) / elapsed / 1e6 << " Mtokens/s" << endl;
+    }
+    return true;
+}
+
+// Accepts plain byte counts and K, M, G suffixes
+static std::size_t parseSize(const std::string& size) {
+    std::size_t end;
+    auto value = std::stoull(size, &end);
+    auto unit = end < size.size() ? size[end] : ' ';
+    switch (unit) {
+        case 'K': case 'k': return value << 10;
+        case 'M': case 'm': return value << 20;
+        case 'G': case 'g': return value << 30;
+        default: return value;
+    }
+}
+
+static std::string readDirectory(const std::filesystem::path& directory) {
+    std::vector<std::filesystem::path> files;
+    for (auto& entry : std::filesystem::directory_iterator(directory)) {
+        auto extension = entry.path().extension();
+        if (entry.is_regular_file() && (extension == ".cl" || extension == ".cool")) files.push_back(entry.path());
+    }
+    std::sort(files.begin(), files.end());
+
+    std::string text;
+    for (auto& file : files) {
+        text += Source::fromFile(file.string()).text();
+        text += '\n';
+    }
+    return text;
+}
+
+int main(int argc, char** argv) {
+    std::vector<std::size_t> sizes;
+    std::vector<Mix> mixes;
+    std::vector<std::string> fileNames;
+    double minimumSeconds = 0.5;
+    try {
+        for (int i = 1; i < argc; i++) {
+            auto argument = std::string(argv[i]);
+            if (argument.rfind("--size=", 0) == 0) {
+                sizes.push_back(parseSize(argument.substr(7)));
+            } else if (argument.rfind("--mix=", 0) == 0) {
+                auto name = argument.substr(6);
+                auto mix = std::find_if(MIXES.begin(), MIXES.end(), [&name](const Mix& mix) { return mix.name == name; });
+                if (mix == MIXES.end()) throw std::runtime_error("Unknown mix " + name);
+                mixes.push_back(*mix);
+            } else if (argument.rfind("--time=", 0) == 0) {
+                minimumSeconds = std::stod(argument.substr(7));
+            } else {
+                fileNames.push_back(argument);
+            }
+        }
+    } catch (const std::exception& e) {
+        cerr << e.what() << endl;
+        cerr << "Usage: lexer_bench [--size=bytes[K|M|G]]... [--mix=name]... [--time=seconds] [file.cl]..." << endl;
+        cerr << "Mixes:";
+        for (auto& mix : MIXES) cerr << ' ' << mix.name;
+        cerr << endl;
+        return 1;
+    }
+    if (sizes.empty()) sizes = {64 << 10, 16 << 20};
+    if (mixes.empty()) mixes = MIXES;
+
+    cout << "scan kernels: " << scanKernelName() << endl;
+    try {
+        for (auto& mix : mixes) {
+            for (auto size : sizes) {
+                auto text = CorpusGenerator(mix).generate(size);
+                auto name = mix.name + " " + std::to_string(text.size() >> 10) + " KB";
+                if (!benchmark(name, text, minimumSeconds)) return 1;
+            }
+        }
+
+        if (fileNames.empty()) {
+            for (auto directory : {"assignments/PA2/tests", "examples"}) {
+                auto text = readDirectory(std::filesystem::path(COOL_SOURCE_DIR) / directory);
+                if (!benchmark(directory, text, minimumSeconds)) return 1;
+            }
+        }
+        for (auto& fileName : fileNames) {
+            auto source = Source::fromFile(fileName);
+            if (!benchmark(std::filesystem::path(fileName).filename().string(), source.text(), minimumSeconds)) return 1;
+        }
+    } catch (const std::runtime_error& e) {
+        cerr << e.what() << endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,44 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "Lexer.h"
+
+// Keeps the tokens of a program text up to date while the text is edited, e.g. in an editor. An edit
+// only relexes from the last token before it until the new tokens line up with the old ones again,
+// so its cost depends on the size of the edit rather than the size of the file.
+class IncrementalLexer {
+public:
+    // Replaces deletedLength bytes at offset with insertedText
+    struct Edit {
+        std::size_t offset;
+        std::size_t deletedLength;
+        std::string_view insertedText;
+    };
+
+    // tokens()[first, first + inserted) replaced `removed` tokens of the previous stream
+    struct Change {
+        std::size_t first;
+        std::size_t removed;
+        std::size_t inserted;
+    };
+
+    explicit IncrementalLexer(std::string text);
+    IncrementalLexer(const IncrementalLexer&) = delete;
+    IncrementalLexer& operator=(const IncrementalLexer&) = delete;
+
+    Change apply(const Edit& edit);
+
+    std::string_view text() const { return program; }
+    // Lexemes point into text() and stay valid until the next edit
+    const std::vector<Token>& tokens() const { return stream; }
+
+private:
+    // Moves a token of the previous text by delta bytes and lineDelta lines into the current text
+    void relocate(Token& token, std::uintptr_t previous, std::size_t previousSize, std::ptrdiff_t delta,
+                  std::ptrdiff_t lineDelta) const;
+
+    std::string program;
+    std::vector<Token> stream;
+};
@@ -1,32 +1,79 @@
 #pragma once
+#include <memory>
 #include <sstream>
+#include <string_view>
 #include <utility>
+#include "LineIndex.h"
+#include "Source.h"
 #include "Token.h"
+#include "TokenBuffer.h"
+#include "TokenHandler.h"
 
 class Lexer {
 public:
-    explicit Lexer(std::string  program) : program(std::move(program)) {}
+    // EAGER counts lines while scanning and stores them in every token. DEFERRED skips the per-byte
+    // newline checks: tokens get line 0 and lineOf resolves them from a LineIndex built on first use.
+    enum class LineTracking {
+        EAGER,
+        DEFERRED
+    };
+
+    explicit Lexer(std::string program, LineTracking lines = LineTracking::EAGER)
+        : Lexer(Source(std::move(program)), lines) {}
+    explicit Lexer(Source source, LineTracking lines = LineTracking::EAGER)
+        : source(std::move(source)), program(this->source.text()), lines(lines),
+          lineNumber(lines == LineTracking::EAGER ? 1 : 0) {}
 
     bool hasNext();
     Token next();
+    // Lexes all remaining tokens in one pass. Programs must be smaller than 4 GB
+    TokenBuffer tokenizeAll();
+    // Pushes all remaining tokens to the handler
+    void lex(TokenHandler& handler);
+
+    std::size_t lineOf(const Token& token);
+
+    // ERROR if str isn't a keyword, BOOL_CONST for true/false in any case
+    static Token::Kind getKeywordType(std::string_view str);
 
 private:
+    // lexes single tokens out of its chunk buffer
+    friend class StreamingLexer;
+    // restarts lexing in the middle of an edited text
+    friend class IncrementalLexer;
+
+    // What the scanning functions produce: text points into the program, to a literal or to scratch
+    struct RawToken {
+        Token::Kind kind;
+        std::string_view text;
+    };
+
     char advance();
     char peek();
     char peekNext();
     bool match(char expected);
     bool isAtEnd();
+    const char* current() const { return program.data() + offset; }
+    const char* end() const { return program.data() + program.size(); }
+    // Moves forward to position, counting the skipped lines in bulk
+    void skipTo(const char* position);
 
-    Token string();
-    Token number();
-    Token identifier();
-    static Token::Kind getKeywordType(const std::string& str);
+    RawToken scan();
+    RawToken string();
+    RawToken number();
+    RawToken identifier();
+    bool isScratch(std::string_view text) const { return !text.empty() && text.data() == scratch.data(); }
     bool tryToSkipMultiLineComment();
 private:
-    std::string program;
-    std::size_t lineNumber = 1;
+    Source source;
+    std::string_view program;
+    LineTracking lines;
+    std::unique_ptr<LineIndex> lineIndex;
+    std::size_t lineNumber;
     std::size_t offset = 0;
     std::size_t comments = 0;
+    // lexemes that differ from the program text, reused by every token
+    std::string scratch;
 
     static const std::size_t MAX_STR_LENGTH = 1024;
 };
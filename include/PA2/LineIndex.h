@@ -0,0 +1,21 @@
+#pragma once
+#include <string_view>
+#include <vector>
+
+// Start offsets of all lines of a program text. Maps byte offsets to line and column numbers, so the
+// lexer (and later phases reporting diagnostics) can keep only offsets and resolve lines on demand.
+class LineIndex {
+public:
+    explicit LineIndex(std::string_view text);
+
+    // 1-based line containing offset. An offset right after a '\n' belongs to the next line
+    std::size_t line(std::size_t offset) const;
+    // 1-based column of offset within its line
+    std::size_t column(std::size_t offset) const;
+    // Offset of the first byte of a 1-based line
+    std::size_t lineStart(std::size_t line) const { return starts.at(line - 1); }
+    std::size_t lineCount() const { return starts.size(); }
+
+private:
+    std::vector<std::size_t> starts;
+};
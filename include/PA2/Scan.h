@@ -0,0 +1,24 @@
+#pragma once
+#include <cstddef>
+
+// Bulk scanning kernels the Lexer uses to skip whitespace and comments and to copy string constants. On x86 they have SSE2 and
+// AVX2 versions, and the best one the CPU supports is picked on first use. Other targets get the
+// scalar versions. Every kernel looks at [begin, end) and returns end if nothing is found.
+
+// First byte that isn't whitespace
+const char* skipWhitespace(const char* begin, const char* end);
+
+// First '\n', i.e. the end of a '--' comment
+const char* findNewline(const char* begin, const char* end);
+
+// First '(' or '*', the only bytes that can open or close a nested comment
+const char* findCommentDelimiter(const char* begin, const char* end);
+
+// First byte a string constant can't copy as is: '"', '\\', or a control or non-ASCII byte
+// (negative as a char), which includes '\n' and '\0'
+const char* findStringSpecial(const char* begin, const char* end);
+
+std::size_t countNewlines(const char* begin, const char* end);
+
+// Name of the kernel set in use: "avx2", "sse2" or "scalar"
+const char* scanKernelName();
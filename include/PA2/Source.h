@@ -0,0 +1,35 @@
+#pragma once
+#include <string>
+#include <string_view>
+#include <memory>
+
+// Read-only program text for the Lexer. Regular files are mapped into memory,
+// so the lexer works directly on the page cache without copying. Anything that
+// can't be mapped (stdin, pipes, empty files) is read into an owned buffer.
+class Source {
+public:
+    explicit Source(std::string text);
+    Source(Source&& other) noexcept;
+    Source& operator=(Source&& other) noexcept;
+    Source(const Source&) = delete;
+    Source& operator=(const Source&) = delete;
+    ~Source();
+
+    static Source fromFile(const std::string& fileName);
+    static Source fromDescriptor(int fd);
+    // Doesn't take ownership, text must outlive the Source
+    static Source borrow(std::string_view text);
+
+    std::string_view text() const { return {data, size}; }
+    bool isMapped() const { return mapped; }
+
+private:
+    Source() = default;
+    void release();
+
+    const char* data = "";
+    std::size_t size = 0;
+    bool mapped = false;
+    // heap-allocated so that `data` stays valid when the Source is moved
+    std::unique_ptr<std::string> owned;
+};
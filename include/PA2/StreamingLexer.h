@@ -0,0 +1,44 @@
+#pragma once
+#include <string>
+#include "Lexer.h"
+
+// Lexes a file descriptor (a file, a pipe, stdin) chunk by chunk instead of reading the whole program
+// first. Whitespace and comments are skipped as they arrive, so only the bytes of the current token
+// are kept between chunks and memory stays bounded by the chunk size plus the longest token.
+class StreamingLexer {
+public:
+    static const std::size_t DEFAULT_CHUNK_SIZE = 64 * 1024;
+
+    // fd is not closed by the lexer
+    explicit StreamingLexer(int fd, std::size_t chunkSize = DEFAULT_CHUNK_SIZE);
+
+    bool hasNext();
+    // The lexeme of the returned token is valid until the next call to hasNext() or next()
+    Token next();
+
+private:
+    bool fill();
+    char peekNext();
+    bool tokenComplete();
+    bool stringComplete(std::string_view token);
+
+    int fd;
+    std::size_t chunkSize;
+    // unconsumed input starts at buffer[position]
+    std::string buffer;
+    std::size_t position = 0;
+    // offset of buffer[0] in the whole input
+    std::size_t consumed = 0;
+    bool eof = false;
+
+    std::size_t lineNumber = 1;
+    std::size_t comments = 0;
+    bool inLineComment = false;
+
+    // bytes of the token at position that are known not to end it, and whether they put a string
+    // constant past a null character, so each byte of a token is examined once however often it is filled
+    std::size_t scanned = 0;
+    bool afterNull = false;
+    // lexes every token, pointed at the unconsumed input each time
+    Lexer lexer{Source::borrow({})};
+};
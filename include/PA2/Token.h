@@ -1,5 +1,7 @@
 #pragma once
+#include <cstdint>
 #include <string>
+#include <string_view>
 #include <utility>
 #include <stdexcept>
 #include <map>
@@ -7,7 +9,7 @@
 
 class Token {
 public:
-    enum Kind {
+    enum Kind : std::uint8_t {
         CLASS,
         ELSE,
         FI,
@@ -38,15 +40,50 @@ public:
         ATOM // used for single atom symbol
     };
 
-    Token(Kind kind, std::size_t line) : kind(kind), lexeme(""), line(line) {}
+    Token(Kind kind, std::size_t line) : kind(kind), line(line) {}
 
-    Token(std::string lexeme, std::size_t line) : kind(Kind::ATOM), lexeme(std::move(lexeme)), line(line) {}
+    Token(std::string_view lexeme, std::size_t line) : kind(Kind::ATOM), text(lexeme), line(line) {}
 
-    Token(Kind kind, std::string lexeme, std::size_t line) : kind(kind), lexeme(std::move(lexeme)), line(line) {}
+    // lexeme must outlive the token: it either points into the program text or is a literal
+    Token(Kind kind, std::string_view lexeme, std::size_t line) : kind(kind), text(lexeme), line(line) {}
 
-    std::string toString();
+    // Used only for lexemes that differ from the program text, e.g. strings with escapes
+    static Token owning(Kind kind, std::string lexeme, std::size_t line) {
+        Token token(kind, line);
+        token.storage = std::move(lexeme);
+        token.owned = true;
+        return token;
+    }
+
+    Kind getKind() const { return kind; }
+    std::string_view getLexeme() const { return owned ? std::string_view(storage) : text; }
+    // Points a token that doesn't own its lexeme to another copy of it, e.g. in an edited program text
+    void setLexeme(std::string_view lexeme) { text = lexeme; }
+    // 0 if the lexer defers line tracking, see Lexer::lineOf
+    std::size_t getLine() const { return line; }
+    void setLine(std::size_t line) { this->line = line; }
+
+    // Bytes of the program text the token was lexed from
+    std::size_t getOffset() const { return offset; }
+    std::size_t getLength() const { return length; }
+    void setSpan(std::size_t offset, std::size_t length) {
+        this->offset = offset;
+        this->length = length;
+    }
+
+    std::string toString() const;
+    // Appends toString() to out without temporary strings
+    void appendTo(std::string& out) const;
+    // appendTo() for a token that was never built, e.g. one pushed to a TokenHandler
+    static void format(std::string& out, Kind kind, std::string_view lexeme, std::size_t line);
 private:
     Kind kind;
-    std::string lexeme;
+    std::string_view text;
+    std::string storage;
+    bool owned = false;
     std::size_t line;
+    std::size_t offset = 0;
+    std::size_t length = 0;
 };
+
+std::string_view asString(Token::Kind kind);
@@ -0,0 +1,35 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "Token.h"
+
+// All tokens of a program as parallel arrays, filled by Lexer::tokenizeAll(). Consumers that walk the
+// kinds or offsets touch only those arrays, and no Token is built per token. Lexemes are resolved from
+// the program text, which must outlive the buffer like it must outlive a Token.
+class TokenBuffer {
+public:
+    explicit TokenBuffer(std::string_view program) : program(program) {}
+
+    std::vector<Token::Kind> kinds;
+    std::vector<std::uint32_t> offsets;
+    std::vector<std::uint32_t> lengths;
+    std::vector<std::uint32_t> lines;
+
+    std::size_t size() const { return kinds.size(); }
+    void reserve(std::size_t capacity);
+    void push(Token::Kind kind, std::size_t offset, std::size_t length, std::size_t line);
+    // For lexemes that differ from the program text: strings with escapes and error messages
+    void pushOwned(Token::Kind kind, std::size_t offset, std::size_t length, std::size_t line, std::string_view lexeme);
+
+    // The lexeme Token::getLexeme() returns for the i-th token
+    std::string_view lexeme(std::size_t i) const;
+    Token token(std::size_t i) const;
+
+private:
+    std::string_view program;
+    // sorted by token index, only a few tokens have them
+    std::vector<std::uint32_t> ownedIndices;
+    std::vector<std::string> ownedLexemes;
+};
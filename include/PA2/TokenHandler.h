@@ -0,0 +1,19 @@
+#pragma once
+#include <string_view>
+#include "Token.h"
+
+// Receives the tokens of Lexer::lex() as they are scanned, without a Token built for each of them.
+// Lexemes are what Token::getLexeme() would return and are valid only during the call. Offsets and
+// lengths are the bytes of the program text, lines are 0 if the lexer defers line tracking.
+class TokenHandler {
+public:
+    virtual ~TokenHandler() = default;
+
+    virtual void onToken(Token::Kind kind, std::string_view lexeme, std::size_t offset, std::size_t length,
+                         std::size_t line) = 0;
+    // Lexical errors. Unless overridden they reach onToken() as tokens of kind ERROR whose lexeme is the
+    // message, like Token::getLexeme() of an error token, so a handler can't lose them by accident
+    virtual void onError(std::string_view message, std::size_t offset, std::size_t length, std::size_t line) {
+        onToken(Token::Kind::ERROR, message, offset, length, line);
+    }
+};
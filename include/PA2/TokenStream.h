@@ -0,0 +1,43 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include "Token.h"
+#include "TokenStreamFormat.h"
+
+// Binary token stream written by `cool_lexer --format=binary` and read by the parser front end
+// (src/PA3/token-reader.cc), so tokens don't have to be printed as text and scanned again.
+//
+// The stream is a sequence of sections, one per lexed file:
+//     SECTION 'C' 'T' 'K' VERSION  varint(name length) name
+// followed by one record per token:
+//     kind  varint(line - line of the previous token in the section)  payload
+//
+// kind is the character itself for single-character tokens, which are all below KIND_BASE, and
+// KIND_BASE + (parser token code - FIRST_PARSER_CODE) for the others. Payloads:
+//     TYPEID, OBJECTID, INT_CONST, STR_CONST   varint(id) of a string interned in the section. Identifiers,
+//                                              integers and strings have separate id spaces, matching idtable,
+//                                              inttable and stringtable. An id equal to the number of strings
+//                                              in its space defines the next one and is followed by
+//                                              varint(length) and the bytes. Strings are stored unescaped
+//     BOOL_CONST                               one byte, 0 or 1
+//     ERROR                                    varint(length) message
+//     everything else                          nothing
+// Varints are unsigned LEB128.
+namespace TokenStream {
+    // Token codes of cool-parse.h
+    inline int parserCode(Token::Kind kind) {
+        switch (kind) {
+            case Token::Kind::ERROR: return ERROR_CODE;
+            case Token::Kind::LET_STMT: return LET_STMT_CODE;
+            default: return FIRST_PARSER_CODE + kind;
+        }
+    }
+
+    inline void appendVarint(std::string& out, std::uint64_t value) {
+        while (value >= 0x80) {
+            out += static_cast<char>(value | 0x80);
+            value >>= 7;
+        }
+        out += static_cast<char>(value);
+    }
+}
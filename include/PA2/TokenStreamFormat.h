@@ -0,0 +1,23 @@
+#pragma once
+
+// Constants of the binary token stream (see TokenStream.h for the layout). They are kept apart from
+// TokenStream.h, which needs Token.h, so that the parser front end (src/PA3/token-reader.cc) can include
+// them next to cool-parse.h, whose token macros clash with Token::Kind.
+namespace TokenStream {
+    const unsigned char SECTION = 0xF0;
+    const char MAGIC[] = {'C', 'T', 'K'};
+    const unsigned char VERSION = 1;
+    const unsigned char KIND_BASE = 0x80;
+
+    // Token codes of cool-parse.h. The others follow CLASS in the order of Token::Kind
+    const int FIRST_PARSER_CODE = 258;
+    const int ERROR_CODE = 283;
+    const int LET_STMT_CODE = 285;
+
+    enum Space {
+        IDENTIFIERS,
+        INTEGERS,
+        STRINGS,
+        SPACE_COUNT
+    };
+}
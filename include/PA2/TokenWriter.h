@@ -0,0 +1,56 @@
+#pragma once
+#include <deque>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include "Token.h"
+#include "TokenHandler.h"
+#include "TokenStream.h"
+
+// Formats tokens the way Token::toString does, one per line, into a reusable buffer that is written
+// to a file descriptor with a few large write() calls instead of a flushed stream line per token.
+// In the BINARY format tokens are packed as described in TokenStream.h instead. As a TokenHandler it
+// writes the tokens Lexer::lex() pushes without building them.
+class TokenWriter : public TokenHandler {
+public:
+    enum class Format {
+        TEXT,
+        BINARY
+    };
+
+    static const std::size_t DEFAULT_CAPACITY = 256 * 1024;
+
+    explicit TokenWriter(int fd, Format format = Format::TEXT, std::size_t capacity = DEFAULT_CAPACITY);
+    // Keeps everything in memory until release(), e.g. to print files lexed concurrently in order
+    explicit TokenWriter(Format format = Format::TEXT);
+    TokenWriter(const TokenWriter&) = delete;
+    TokenWriter& operator=(const TokenWriter&) = delete;
+    ~TokenWriter() override;
+
+    // The '#name "file.cl"' header or the binary section, fileName is reduced to its last path component
+    void writeName(std::string_view fileName);
+    void write(const Token& token);
+    void onToken(Token::Kind kind, std::string_view lexeme, std::size_t offset, std::size_t length,
+                 std::size_t line) override;
+    void onError(std::string_view message, std::size_t offset, std::size_t length, std::size_t line) override;
+    // Already formatted output, e.g. released by an in-memory writer
+    void append(std::string_view text);
+    void flush();
+    std::string release() { return std::move(buffer); }
+
+private:
+    void writeBinary(Token::Kind kind, std::string_view lexeme, std::size_t line);
+    void writeInterned(TokenStream::Space space, std::string_view text);
+    void flushIfFull();
+
+    int fd;
+    Format format;
+    std::size_t capacity;
+    std::string buffer;
+
+    // binary format only, reset by every section
+    std::size_t lastLine = 0;
+    std::unordered_map<std::string_view, std::size_t> interned[TokenStream::SPACE_COUNT];
+    // owns the keys of interned, a deque doesn't move them
+    std::deque<std::string> internedText;
+};
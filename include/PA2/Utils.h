@@ -1,42 +1,87 @@
 #pragma once
-#include <algorithm>
-#include <cctype>
+#include <array>
 #include <string>
-#include<iomanip>
+#include <string_view>
 
-bool isDigit(char c) {
-    return c >= '0' && c <= '9';
+enum CharClass : unsigned char {
+    DIGIT = 1 << 0,
+    ALPHA = 1 << 1,
+    UNDERSCORE = 1 << 2,
+    WHITESPACE = 1 << 3,
+    NEWLINE = 1 << 4,
+    IDENTIFIER = DIGIT | ALPHA | UNDERSCORE,
+};
+
+constexpr std::array<unsigned char, 256> makeCharClasses() {
+    std::array<unsigned char, 256> classes{};
+    for (int c = '0'; c <= '9'; c++) classes[c] = DIGIT;
+    for (int c = 'a'; c <= 'z'; c++) classes[c] = ALPHA;
+    for (int c = 'A'; c <= 'Z'; c++) classes[c] = ALPHA;
+    classes['_'] = UNDERSCORE;
+    for (unsigned char c : {' ', '\f', '\r', '\t', '\v'}) classes[c] = WHITESPACE;
+    classes['\n'] = WHITESPACE | NEWLINE;
+    return classes;
 }
 
-bool isAlpha(char c) {
-    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z');
+// One load per byte instead of a chain of comparisons
+inline constexpr std::array<unsigned char, 256> CHAR_CLASSES = makeCharClasses();
+
+constexpr bool hasClass(char c, unsigned char classes) {
+    return (CHAR_CLASSES[static_cast<unsigned char>(c)] & classes) != 0;
 }
 
-bool isAlphaOdDigitOrUnderscore(char c) {
-    return isAlpha(c) || isDigit(c) || c == '_';
+constexpr bool isDigit(char c) {
+    return hasClass(c, DIGIT);
 }
 
-bool isWhitespace(char c) {
-    return c == ' ' || c == '\f' || c == '\r' || c == '\t' || c == '\v' || c == '\n';
+constexpr bool isAlpha(char c) {
+    return hasClass(c, ALPHA);
 }
 
-std::string toLowerCase(const std::string& str) {
-    auto copy = std::string(str);
-    std::transform(copy.begin(), copy.end(), copy.begin(), [](unsigned char c){ return std::tolower(c); });
-    return copy;
+constexpr bool isAlphaOdDigitOrUnderscore(char c) {
+    return hasClass(c, IDENTIFIER);
 }
 
-std::string charToStringRepresentation(char c) {
-    if (c == '\\') return "\\\\";
-    if ((int) c >= 32) return std::string(1, c);
+constexpr bool isWhitespace(char c) {
+    return hasClass(c, WHITESPACE);
+}
+
+// keyword must be in lower case. Setting bit 0x20 lowercases ASCII letters and never turns any other byte into one
+constexpr bool equalsIgnoreCase(std::string_view str, std::string_view keyword) {
+    if (str.size() != keyword.size()) return false;
+    for (std::size_t i = 0; i < str.size(); i++) {
+        if ((str[i] | 0x20) != keyword[i]) return false;
+    }
+    return true;
+}
+
+// Appends c the way the reference lexer prints it inside strings and errors. Other control characters
+// and bytes above 127 (negative as a char) are printed as octal escapes of their int value.
+inline void appendCharRepresentation(std::string& out, char c) {
+    if (c == '\\') {
+        out += "\\\\";
+        return;
+    }
+    if ((int) c >= 32) {
+        out += c;
+        return;
+    }
     switch (c) {
-        case '\n': return "\\n";
-        case '\f': return "\\f";
-        case '\t': return "\\t";
-        case '\b': return "\\b";
+        case '\n': out += "\\n"; return;
+        case '\f': out += "\\f"; return;
+        case '\t': out += "\\t"; return;
+        case '\b': out += "\\b"; return;
     }
-    std::stringstream str;
-    str << '\\' << std::oct << std::setw(3) << std::setfill('0') << (int) c;
-    return str.str();
+    char digits[12];
+    auto last = digits + sizeof(digits);
+    auto first = last;
+    auto value = static_cast<unsigned>(static_cast<int>(c));
+    do {
+        *--first = static_cast<char>('0' + (value & 7));
+        value >>= 3;
+    } while (value != 0);
+    while (last - first < 3) *--first = '0';
+    out += '\\';
+    out.append(first, last);
 }
 
@@ -0,0 +1,194 @@
+// -*-Mode: C++;-*-
+//
+// See copyright.h for copyright notice and limitation of liability
+// and disclaimer of warranty provisions.
+//
+#include "copyright.h"
+
+
+#ifndef _ARENA_H_
+#define _ARENA_H_
+
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <new>
+#include "cool-io.h"
+
+//////////////////////////////////////////////////////////////////////
+//
+//  arena.h
+//
+//  A bump allocator.  Memory is carved out of large blocks in the
+//  order it is requested and is given back all at once by release()
+//  or when the arena is destroyed.  release(m) gives back only what
+//  was allocated after mark() returned m, so an arena can also serve
+//  nested lifetimes like scopes.  Objects placed in an arena are
+//  never destroyed, so they must not own anything outside it.
+//
+//////////////////////////////////////////////////////////////////////
+
+class Arena {
+private:
+  struct Block {
+    Block *prev;     // the block filled before this one
+    size_t size;     // bytes following the header
+  };
+  enum { FIRST_BLOCK_SIZE = 4 * 1024, BLOCK_SIZE = 64 * 1024 };
+
+  Block *top;        // the block allocations come from, NULL if none
+  char *next;        // the first free byte of top
+  char *limit;       // the end of top
+  size_t block_size; // the size of the next block
+  Block *spare;      // the last block given back by release(m), if kept
+
+  size_t used;       // bytes handed out since the last release
+  size_t peak;       // the most bytes ever in use
+  size_t reserved;   // bytes of the blocks
+  int blocks;
+  long allocations;
+
+  void new_block(size_t size);
+
+  // arenas own their blocks, so they are not copied
+  Arena(const Arena&);
+  Arena& operator=(const Arena&);
+public:
+  Arena(): top(NULL), next(NULL), limit(NULL), block_size(FIRST_BLOCK_SIZE),
+           spare(NULL), used(0), peak(0), reserved(0), blocks(0),
+           allocations(0) { }
+  ~Arena() { release(); }
+
+  // size bytes aligned to align, which must be a power of two
+  void *allocate(size_t size, size_t align = sizeof(void *));
+
+  // a null terminated copy of the first len characters of s
+  char *copy_string(const char *s, int len);
+
+  // frees every block; everything allocated so far becomes invalid
+  void release();
+
+  struct Mark {
+    Block *top;
+    char *next;
+    size_t used;
+  };
+
+  // the current state of the arena
+  Mark mark() const;
+
+  // gives back everything allocated since m was returned by mark().
+  // Marks taken after m become invalid.
+  void release(const Mark& m);
+
+  size_t bytes_used() const     { return used; }
+  size_t peak_bytes() const     { return peak; }
+  size_t bytes_reserved() const { return reserved; }
+  int block_count() const       { return blocks; }
+  long allocation_count() const { return allocations; }
+
+  ostream& print_stats(ostream& s) const;
+};
+
+inline void *Arena::allocate(size_t size, size_t align)
+{
+  size_t pad = (align - ((size_t) next & (align - 1))) & (align - 1);
+  if (pad + size > (size_t) (limit - next)) {
+    new_block(size + align);
+    pad = (align - ((size_t) next & (align - 1))) & (align - 1);
+  }
+  char *p = next + pad;
+  next = p + size;
+  used += size;
+  if (used > peak)
+    peak = used;
+  allocations++;
+  return p;
+}
+
+inline char *Arena::copy_string(const char *s, int len)
+{
+  char *str = (char *) allocate(len + 1, 1);
+  memcpy(str, s, len);
+  str[len] = '\0';
+  return str;
+}
+
+//
+// Blocks double in size from FIRST_BLOCK_SIZE up to BLOCK_SIZE bytes, so
+// small arenas stay small.  A single allocation may need a larger block.
+//
+inline void Arena::new_block(size_t size)
+{
+  if (size < block_size)
+    size = block_size;
+  Block *b;
+  if (spare && spare->size >= size) {
+    b = spare;
+    spare = NULL;
+  } else {
+    if (block_size < BLOCK_SIZE)
+      block_size *= 2;
+    b = (Block *) malloc(sizeof(Block) + size);
+    if (!b)
+      throw std::bad_alloc();
+    b->size = size;
+    reserved += sizeof(Block) + size;
+    blocks++;
+  }
+  b->prev = top;
+  top = b;
+  next = (char *) (b + 1);
+  limit = next + b->size;
+}
+
+inline void Arena::release()
+{
+  while (top) {
+    Block *prev = top->prev;
+    free(top);
+    top = prev;
+  }
+  free(spare);
+  spare = NULL;
+  next = limit = NULL;
+  block_size = FIRST_BLOCK_SIZE;
+  used = reserved = 0;
+  blocks = 0;
+}
+
+inline Arena::Mark Arena::mark() const
+{
+  Mark m = { top, next, used };
+  return m;
+}
+
+//
+// The blocks filled since the mark are freed, except for the last one,
+// which is kept for the next block needed.  Scopes that are entered and
+// exited over and over then don't go to malloc every time.
+//
+inline void Arena::release(const Mark& m)
+{
+  while (top != m.top) {
+    Block *prev = top->prev;
+    if (spare) {
+      reserved -= sizeof(Block) + spare->size;
+      blocks--;
+      free(spare);
+    }
+    spare = top;
+    top = prev;
+  }
+  next = m.next;
+  limit = top ? (char *) (top + 1) + top->size : NULL;
+  used = m.used;
+}
+
+inline ostream& Arena::print_stats(ostream& s) const
+{
+  return s << allocations << " allocations, " << used << " bytes used (peak "
+           << peak << "), " << reserved << " bytes in " << blocks << " blocks";
+}
+
+#endif
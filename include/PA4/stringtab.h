@@ -13,6 +13,9 @@
 #include <string.h>
 #include "list.h"    // list template
 #include "cool-io.h"
+#include "arena.h"
+#include <atomic>
+#include <mutex>
 
 class Entry;
 typedef Entry* Symbol;
@@ -32,6 +35,8 @@ protected:
   int  len;      // the length of the string (without trailing \0)
   int index;     // a unique index for each string
 public:
+  // s is not copied; it must be null terminated and outlive the Entry.
+  // String tables keep the strings of their entries in their arena.
   Entry(char *s, int l, int i);
 
   // is string argument equal to the str of this Entry?
@@ -93,10 +98,61 @@ template <class Elem>
 class StringTable
 {
 protected:
-   List<Elem> *tbl;   // a string table is a list
-   int index;         // the current index
+   // The entries are split over SHARDS shards by the top bits of the hash
+   // of their string.  Each shard has its own lock, its own arena for the
+   // entries and their strings and its own open-addressing hash index,
+   // probed linearly.  Strings are added under the lock of their shard
+   // only; looking them up takes no lock at all.
+   enum { SHARD_BITS = 3, SHARDS = 1 << SHARD_BITS, MINSLOTS = 64 };
+
+   // An index is never changed once a slot is filled, it is replaced by
+   // a larger one.  The number of slots is a power of two and at most
+   // half of them are used; empty slots are NULL.  hashes[i] caches the
+   // hash of the string in slots[i] and is written before the slot.
+   // Replaced indices are kept until the table is destroyed, since
+   // lookups may still be probing them.
+   struct Index {
+     int capacity;
+     std::atomic<Elem *> *slots;
+     unsigned *hashes;
+     Index *replaced;
+   };
+
+   struct Shard {
+     std::mutex lock;
+     std::atomic<Index *> index;
+     int count;         // entries in the shard
+     Arena arena;
+     Shard(): index((Index *) NULL), count(0) { }
+   };
+
+   // The entry with index i is in segment s of tbl, where segment s holds
+   // the FIRST_SEGMENT << s entries after those in the segments before
+   // it.  Segments are allocated as they are needed, zeroed, and never
+   // move.  An index is handed out before its entry is stored, so the
+   // iterator only goes up to `published': all entries below it are
+   // stored, and it moves over each entry as soon as the entries before
+   // it are stored too.
+   enum { FIRST_SEGMENT = 64, SEGMENTS = 26 };
+
+   Shard shards[SHARDS];
+   std::atomic<std::atomic<Elem *> *> tbl[SEGMENTS];
+   std::atomic<int> index;       // the next index to hand out
+   std::atomic<int> published;   // the number of entries in order
+
+   static Elem *find(Index *ix, char *s, int len, unsigned hash);
+   static int find_slot(Index *ix, char *s, int len, unsigned hash);
+   static Index *grow(Shard& shard);
+   std::atomic<Elem *> *slot(int ind, bool allocate);
+   void publish(Elem *e, int ind);
 public:
-   StringTable(): tbl((List<Elem> *) NULL), index(0) { }   // an empty table
+   StringTable();   // an empty table
+   ~StringTable();
+   // Any number of threads may add and look up strings at the same time.
+   // Each entry is created exactly once, so Symbols of equal strings are
+   // equal whichever thread added them.  Indices are handed out in the
+   // order entries are created.
+   //
    // The following methods each add a string to the string table.  
    // Only one copy of each string is maintained.  
    // Returns a pointer to the string table entry with the string.
@@ -111,7 +167,8 @@ public:
    Elem *add_int(int i);
 
 
-   // An iterator.
+   // An iterator.  Entries added concurrently with the iteration may or
+   // may not be seen.
    int first();       // first index
    int more(int i);   // are there more indices?
    int next(int i);   // next index
@@ -121,6 +178,9 @@ public:
 
    void print();  // print the entire table; for debugging
 
+   // print the memory used by the table
+   void print_stats(ostream& s, const char *name);
+
 };
 
 class IdTable : public StringTable<IdEntry> { };
@@ -140,4 +200,7 @@ public:
 extern IdTable idtable;
 extern IntTable inttable;
 extern StrTable stringtable;
+
+// print the memory used by the three tables
+void print_stringtab_stats(ostream& s);
 #endif
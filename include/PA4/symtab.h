@@ -8,6 +8,8 @@
 //
 // Create a symbol table with :
 // SymbolTable<thing to look up on, info to store> name();
+// or, for a table that finds symbols in constant time :
+// HashedSymbolTable<thing to look up on, info to store> name();
 //
 // You must enter a scope before adding anything to the symbol table.
 
@@ -15,6 +17,7 @@
 #define _SYMTAB_H_
 
 #include "list.h"
+#include "arena.h"
 
 //
 // SymtabEnty<SYM,DAT> defines the entry for a symbol table that associates
@@ -45,9 +48,12 @@ public:
 //       is the scope it pointed to previously.
 //
 //    `exitscope' makes the table point to the parent scope of the
-//        current scope.  Note that the old child scope is not
-//        deallocated.  One may save the state of a symbol table
-//        at a given point by copying it with `operator ='
+//        current scope.  The entries and list cells of a table are
+//        allocated in its arena, and the memory of the old child
+//        scope is given back to the arena at once.  One may save the
+//        state of a symbol table at a given point by copying it with
+//        `operator ='.  The copy gets its own copies of the scopes and
+//        entries, so it stays valid whatever happens to the original.
 //
 //    `addid(s,i)' adds a symbol table entry to the current scope of
 //        the symbol table mapping symbol `s' to data `d'.  The old
@@ -69,20 +75,80 @@ public:
 //
 //    `dump()' prints the symbols in the symbol table.
 //
+//    `print_stats(s,name)' prints the number of bindings and the memory
+//        the table holds.
+//
 
 template <class SYM, class DAT>
 class SymbolTable
 {
    typedef SymtabEntry<SYM,DAT> ScopeEntry;
    typedef List<ScopeEntry> Scope;
-   typedef List<Scope> ScopeList;
+
+   // A cell of the list of scopes.  `mark' is the state of `arena' when
+   // the scope was entered and `bindings' the number of bindings then.
+   struct ScopeList {
+     Scope *scope;
+     ScopeList *outer;
+     Arena::Mark mark;
+     int bindings;
+     Scope *hd() const      { return scope; }
+     ScopeList *tl() const  { return outer; }
+   };
 private:
    ScopeList  *tbl;
+   Arena arena;
+   int bindings;        // the number of bindings in all scopes
+   int peak_bindings;
+
+   ScopeList *new_scope(Scope *scope, ScopeList *outer, Arena::Mark mark, int base)
+   {
+       ScopeList *l = (ScopeList *) arena.allocate(sizeof(ScopeList));
+       l->scope = scope;
+       l->outer = outer;
+       l->mark = mark;
+       l->bindings = base;
+       return l;
+   }
+
+   // Enters copies of the scopes of l, outermost first, so that each of
+   // them can be exited on its own.
+   void copy_scopes(ScopeList *l)
+   {
+       if (l == NULL)
+	   return;
+       copy_scopes(l->tl());
+       enterscope();
+       int n = 0;
+       for (Scope *i = l->hd(); i != NULL; i = i->tl())
+	   n++;
+       // the newest entry is at the head of the scope, so it is added last
+       ScopeEntry **entries = new ScopeEntry *[n];
+       int k = n;
+       for (Scope *i = l->hd(); i != NULL; i = i->tl())
+	   entries[--k] = i->hd();
+       for (k = 0; k < n; k++)
+	   addid(entries[k]->get_id(), entries[k]->get_info());
+       delete [] entries;
+   }
 public:
-   SymbolTable(): tbl(NULL) { }     // create a new symbol table
+   SymbolTable(): tbl(NULL), bindings(0), peak_bindings(0) { }     // create a new symbol table
+   SymbolTable(const SymbolTable &s): tbl(NULL), bindings(0), peak_bindings(0)
+   {
+       copy_scopes(s.tbl);
+   }
 
-   // Create pointer to current symbol table.
-   SymbolTable &operator =(const SymbolTable &s) { tbl = s.tbl; return *this; }
+   // Save the current state of a symbol table.
+   SymbolTable &operator =(const SymbolTable &s)
+   {
+       if (this != &s) {
+	   arena.release();
+	   tbl = NULL;
+	   bindings = 0;
+	   copy_scopes(s.tbl);
+       }
+       return *this;
+   }
 
    void fatal_error(char * msg)
    {
@@ -99,7 +165,7 @@ public:
    {
        // The cast of NULL is required for template instantiation to work
        // correctly.
-       tbl = new ScopeList((Scope *) NULL, tbl);
+       tbl = new_scope((Scope *) NULL, tbl, arena.mark(), bindings);
    }
 
    // Pop the first scope off of the symbol table.
@@ -109,7 +175,10 @@ public:
        if (tbl == NULL) {
 	   fatal_error("exitscope: Can't remove scope from an empty symbol table.");
        }
+       ScopeList *scope = tbl;
        tbl = tbl->tl();
+       bindings = scope->bindings;
+       arena.release(scope->mark);
    }
 
    // Add an item to the symbol table.
@@ -117,8 +186,11 @@ public:
    {
        // There must be at least one scope to add a symbol.
        if (tbl == NULL) fatal_error("addid: Can't add a symbol without a scope.");
-       ScopeEntry * se = new ScopeEntry(s,i);
-       tbl = new ScopeList(new Scope(se, tbl->hd()), tbl->tl());
+       ScopeEntry * se = new (arena.allocate(sizeof(ScopeEntry))) ScopeEntry(s,i);
+       Scope *scope = new (arena.allocate(sizeof(Scope))) Scope(se, tbl->hd());
+       tbl = new_scope(scope, tbl->tl(), tbl->mark, tbl->bindings);
+       if (++bindings > peak_bindings)
+	   peak_bindings = bindings;
        return(se);
    }
    
@@ -163,8 +235,238 @@ public:
          }
       }
    }
+
+   void print_stats(ostream& s, const char *name)
+   {
+      s << name << ": " << bindings << " bindings (peak " << peak_bindings << "), ";
+      arena.print_stats(s) << "\n";
+   }
  
 };
 
+//
+// HashedSymbolTable<SYM,DAT> has the interface of SymbolTable<SYM,DAT>
+//    but finds symbols in constant time, however deep the scopes are
+//    nested and however many symbols they hold.  SYM must be a pointer
+//    type; symbols are compared by identity, as in SymbolTable.
+//
+//    Every symbol is mapped by a hash table to its innermost binding,
+//    which points to the binding it shadows in an enclosing scope.
+//    Each binding also goes on an undo log.  `exitscope' pops the
+//    bindings of the top scope off the log and makes the symbols map
+//    to the bindings they shadowed again, so it takes time proportional
+//    to the number of symbols added to that scope.
+//
+//    The bindings are allocated in an arena, and exiting a scope gives
+//    their memory back to it at once.  Unlike SymbolTable, the state of
+//    the table can't be saved by copying it, and the entry returned by
+//    `addid' is valid until its scope is exited.
+//
+
+template <class SYM, class DAT>
+class HashedSymbolTable
+{
+   typedef SymtabEntry<SYM,DAT> ScopeEntry;
+
+   struct Binding {
+     ScopeEntry entry;
+     Binding *shadowed;   // the binding of the symbol in an outer scope
+     int scope;           // the depth of the scope the binding is in
+     Binding(SYM s, DAT *i, Binding *b, int d) :
+       entry(s,i), shadowed(b), scope(d) { }
+   };
+   enum { MINSLOTS = 64, MINLOG = 64, MINSCOPES = 16 };
+
+   // An open-addressing hash table, probed linearly.  keys[i] is a
+   // symbol that has been added to the table and bindings[i] is its
+   // innermost binding, or NULL if none of its scopes are left.  The
+   // number of slots is a power of two and at most half of them are
+   // used; unused slots have a NULL binding and a NULL key.
+   SYM *keys;
+   Binding **bindings;
+   int capacity;
+   int symbols;
+
+   Binding **log;       // every binding, in the order they were added
+   int log_size;
+   int log_capacity;
+
+   // The size of the log and the state of the arena when a scope was
+   // entered; marks[d] belongs to the scope at depth d + 1.
+   struct ScopeMark {
+     int log_size;
+     Arena::Mark arena;
+   };
+   ScopeMark *marks;
+   int depth;           // the number of scopes
+   int marks_capacity;
+
+   Arena arena;
+   int peak_bindings;
+
+   HashedSymbolTable(const HashedSymbolTable&);
+   HashedSymbolTable& operator =(const HashedSymbolTable&);
+
+   static unsigned hash(SYM s)
+   {
+       unsigned long long h = (unsigned long long) (size_t) s * 0x9E3779B97F4A7C15ull;
+       return (unsigned) (h >> 32);
+   }
+
+   // The slot of s, or the free slot where s belongs.
+   int find_slot(SYM s)
+   {
+       int mask = capacity - 1;
+       int i = hash(s) & mask;
+       while (keys[i] != NULL && keys[i] != s)
+	   i = (i + 1) & mask;
+       return i;
+   }
+
+   void grow()
+   {
+       SYM *old_keys = keys;
+       Binding **old_bindings = bindings;
+       int old_capacity = capacity;
+
+       capacity = capacity ? 2 * capacity : MINSLOTS;
+       keys = new SYM[capacity]();
+       bindings = new Binding *[capacity]();
+       for (int i = 0; i < old_capacity; i++)
+	   if (old_keys[i] != NULL) {
+	       int j = find_slot(old_keys[i]);
+	       keys[j] = old_keys[i];
+	       bindings[j] = old_bindings[i];
+	   }
+       delete [] old_keys;
+       delete [] old_bindings;
+   }
+
+   // Doubles the size of an array holding n elements, or makes it
+   // minimum elements long if it is empty.
+   template <class T>
+   static T *grow_array(T *a, int n, int *size, int minimum)
+   {
+       *size = *size ? 2 * *size : minimum;
+       T *b = new T[*size];
+       for (int i = 0; i < n; i++)
+	   b[i] = a[i];
+       delete [] a;
+       return b;
+   }
+
+   // The innermost binding of s, NULL if s isn't bound.
+   Binding *find(SYM s)
+   {
+       if (capacity == 0) return NULL;
+       return bindings[find_slot(s)];
+   }
+public:
+   HashedSymbolTable(): keys(NULL), bindings(NULL), capacity(0), symbols(0),
+			log(NULL), log_size(0), log_capacity(0),
+			marks(NULL), depth(0), marks_capacity(0), peak_bindings(0) { }
+
+   ~HashedSymbolTable()
+   {
+       delete [] keys;
+       delete [] bindings;
+       delete [] log;
+       delete [] marks;
+   }
+
+   void fatal_error(char * msg)
+   {
+     cerr << msg << "\n";
+     exit(1);
+   } 
+
+   // Enter a new scope.  A scope must be entered before anything can be
+   // added to the table.
+   void enterscope()
+   {
+       if (depth == marks_capacity)
+	   marks = grow_array(marks, depth, &marks_capacity, MINSCOPES);
+       marks[depth].log_size = log_size;
+       marks[depth].arena = arena.mark();
+       depth++;
+   }
+
+   // Pop the top scope off of the symbol table, undoing its bindings.
+   void exitscope()
+   {
+       // It is an error to exit a scope that doesn't exist.
+       if (depth == 0) {
+	   fatal_error("exitscope: Can't remove scope from an empty symbol table.");
+       }
+       ScopeMark& mark = marks[--depth];
+       while (log_size > mark.log_size) {
+	   Binding *b = log[--log_size];
+	   bindings[find_slot(b->entry.get_id())] = b->shadowed;
+       }
+       arena.release(mark.arena);
+   }
+
+   // Add an item to the symbol table.
+   ScopeEntry *addid(SYM s, DAT *i)
+   {
+       // There must be at least one scope to add a symbol.
+       if (depth == 0) fatal_error("addid: Can't add a symbol without a scope.");
+       if (2 * (symbols + 1) > capacity)
+	   grow();
+       int slot = find_slot(s);
+       if (keys[slot] == NULL) {
+	   keys[slot] = s;
+	   symbols++;
+       }
+       Binding *b = new (arena.allocate(sizeof(Binding))) Binding(s, i, bindings[slot], depth);
+       bindings[slot] = b;
+       if (log_size == log_capacity)
+	   log = grow_array(log, log_size, &log_capacity, MINLOG);
+       log[log_size++] = b;
+       if (log_size > peak_bindings)
+	   peak_bindings = log_size;
+       return &b->entry;
+   }
+
+   // Lookup an item through all scopes of the symbol table.  If found
+   // it returns the associated information field, if not it returns
+   // NULL.
+   DAT *lookup(SYM s)
+   {
+       Binding *b = find(s);
+       return b ? b->entry.get_info() : NULL;
+   }
+
+   // probe the symbol table.  Check the top scope (only) for the item
+   // 's'.  If found, return the information field.  If not return NULL.
+   DAT *probe(SYM s)
+   {
+       if (depth == 0) {
+	   fatal_error("probe: No scope in symbol table.");
+       }
+       Binding *b = find(s);
+       return b && b->scope == depth ? b->entry.get_info() : NULL;
+   }
+
+   // Prints out the contents of the symbol table  
+   void dump()
+   {
+      int i = log_size;
+      for (int d = depth - 1; d >= 0; d--) {
+	 cerr << "\nScope: \n";
+	 for (; i > marks[d].log_size; i--)
+	    cerr << "  " << log[i - 1]->entry.get_id() << endl;
+      }
+   }
+
+   void print_stats(ostream& s, const char *name)
+   {
+      s << name << ": " << log_size << " bindings (peak " << peak_bindings << "), ";
+      arena.print_stats(s) << ", " << capacity * (sizeof(SYM) + sizeof(Binding *)) +
+	 log_capacity * sizeof(Binding *) + marks_capacity * sizeof(ScopeMark)
+	 << " bytes of index\n";
+   }
+};
+
 #endif
 
@@ -49,11 +49,35 @@
 //
 //
 ////////////////////////////////////////////////////////////////////////////
+//
+// Tree nodes, and the arrays of the vector_nodes, are allocated from the
+// current AST arena.  set_ast_arena(a) makes a the current arena and
+// returns the one it replaces.  A phase makes a new arena current before
+// it builds a program and gives it to the program node with
+// program_class::set_arena, which frees it, and everything built in it,
+// when the program is deleted.  copy_Program builds the copy in a new
+// arena that the copy owns, so it outlives the original.  Trees that
+// must outlive every program are built in an arena of their own.  Without any, nodes go to an arena
+// that is never freed.
+//
+extern Arena *current_ast_arena;
+
+inline Arena *ast_arena()
+{
+    if (!current_ast_arena)
+	current_ast_arena = new Arena;
+    return current_ast_arena;
+}
+
+Arena *set_ast_arena(Arena *a);
+
 class tree_node {
 protected:
     int line_number;            // stash the line number when node is made
 public:
     tree_node();
+    void *operator new(size_t size) { return ast_arena()->allocate(size); }
+    void operator delete(void *) { }    // freed with the arena
     virtual tree_node *copy() = 0;
     virtual ~tree_node() { }
     virtual void dump(ostream& stream, int n) = 0;
@@ -110,6 +134,13 @@ public:
 //     list_node<Elem>::single(e);     where "e" has type Elem
 //     list_node<Elem>::append(l1,l2);
 //
+//     The lists they build are vector_nodes, which keep their elements in
+//     an array, so nth and len take constant time.  Appending to the
+//     list that was built last from an array adds the new elements to the
+//     end of that array, so a list built up one element at a time, as the
+//     parser does, takes time linear in its length.  Lists are never
+//     changed by appending to them.
+//
 //////////////////////////////////////////////////////////////////////////////
 
 template <class Elem> class list_node : public tree_node {
@@ -174,15 +205,59 @@ public:
 };
 
 
+///////////////////////////////////////////////////////////////////////////
+//
+// vector_node
+//
+// A list of the first `length' elements of an array.  Lists made by
+// appending to a vector_node may share its array: the array holds
+// the elements of the longest of them, and only a list with all of
+// them in it may add more.  The lists made by nil and single have no
+// array and keep their element, if any, in `elem'; every list made by
+// append has one, however short it is.
+//
+///////////////////////////////////////////////////////////////////////////
+template <class Elem> class vector_node : public list_node<Elem> {
+private:
+    struct array {
+	Elem *elems;
+	int size;
+	int capacity;
+	Arena *arena;           // holds elems
+    };
+    array *elems;
+    Elem elem;
+    int length;
+
+    vector_node(array *a, Elem e, int n) {
+	elems = a;
+	elem = e;
+	length = n;
+    }
+    Elem at(int n) { return elems ? elems->elems[n] : elem; }
+    static array *new_array();
+    static void add(array *a, Elem e);
+public:
+    static vector_node<Elem> *nil()        { return new vector_node<Elem>(NULL, NULL, 0); }
+    static vector_node<Elem> *single(Elem e) { return new vector_node<Elem>(NULL, e, 1); }
+    static vector_node<Elem> *append(list_node<Elem> *l1, list_node<Elem> *l2);
+
+    list_node<Elem> *copy_list();
+    int len();
+    Elem nth_length(int n, int &len);
+    void dump(ostream& stream, int n);
+};
+
+
 template <class Elem> single_list_node<Elem> *list(Elem x);
 template <class Elem> append_node<Elem> *cons(Elem x, list_node<Elem> *l);
 template <class Elem> append_node<Elem> *xcons(list_node<Elem> *l, Elem x);
 
 
-template <class Elem> list_node<Elem> *list_node<Elem>::nil() { return new nil_node<Elem>(); }
-template <class Elem> list_node<Elem> *list_node<Elem>::single(Elem e) { return new single_list_node<Elem>(e); }
+template <class Elem> list_node<Elem> *list_node<Elem>::nil() { return vector_node<Elem>::nil(); }
+template <class Elem> list_node<Elem> *list_node<Elem>::single(Elem e) { return vector_node<Elem>::single(e); }
 template <class Elem> list_node<Elem> *list_node<Elem>::append(list_node<Elem> *l1,list_node<Elem> *l2) {
-   return new append_node<Elem>(l1,l2);
+   return vector_node<Elem>::append(l1,l2);
 }
 
 
@@ -396,6 +471,145 @@ template <class Elem> void append_node<Elem>::dump(ostream& stream, int n)
 }
 
 
+///////////////////////////////////////////////////////////////////////////
+//
+// vector_node::new_array
+//
+// return an empty array in the current AST arena
+//
+///////////////////////////////////////////////////////////////////////////
+template <class Elem> typename vector_node<Elem>::array *vector_node<Elem>::new_array()
+{
+    Arena *arena = ast_arena();
+    array *a = (array *) arena->allocate(sizeof(array));
+    a->elems = NULL;
+    a->size = a->capacity = 0;
+    a->arena = arena;
+    return a;
+}
+
+
+///////////////////////////////////////////////////////////////////////////
+//
+// vector_node::add
+//
+// add an element to the end of an array, doubling it when it is full.
+// The old elements stay in the arena until it is released.
+//
+///////////////////////////////////////////////////////////////////////////
+template <class Elem> void vector_node<Elem>::add(array *a, Elem e)
+{
+    if (a->size == a->capacity) {
+	a->capacity = a->capacity ? 2 * a->capacity : 4;
+	Elem *elems = (Elem *) a->arena->allocate(a->capacity * sizeof(Elem));
+	for (int i = 0; i < a->size; i++)
+	    elems[i] = a->elems[i];
+	a->elems = elems;
+    }
+    a->elems[a->size++] = e;
+}
+
+
+///////////////////////////////////////////////////////////////////////////
+//
+// vector_node::append
+//
+// append two lists.  The elements of l2 go to the end of the array of
+// l1 if l1 holds all of its elements and the array is in the current
+// AST arena, and to a new array otherwise.  The array of a list built in
+// another arena is never changed, so a list doesn't depend on the arena
+// of the lists it was appended to.
+//
+///////////////////////////////////////////////////////////////////////////
+template <class Elem> vector_node<Elem> *vector_node<Elem>::append(list_node<Elem> *l1, list_node<Elem> *l2)
+{
+    int len, n1 = l1->len(), n2 = l2->len();
+    vector_node<Elem> *v1 = dynamic_cast<vector_node<Elem> *>(l1);
+    array *a;
+    if (v1 && v1->elems && v1->elems->size == n1 && v1->elems->arena == ast_arena())
+	a = v1->elems;
+    else {
+	a = new_array();
+	for (int i = 0; i < n1; i++)
+	    add(a, v1 ? v1->at(i) : l1->nth_length(i, len));
+    }
+    vector_node<Elem> *v2 = dynamic_cast<vector_node<Elem> *>(l2);
+    for (int i = 0; i < n2; i++)
+	add(a, v2 ? v2->at(i) : l2->nth_length(i, len));
+    return new vector_node<Elem>(a, NULL, n1 + n2);
+}
+
+
+///////////////////////////////////////////////////////////////////////////
+//
+// vector_node::copy_list
+//
+// return the deep copy of the vector_node
+//
+///////////////////////////////////////////////////////////////////////////
+template <class Elem> list_node<Elem> *vector_node<Elem>::copy_list()
+{
+    if (length <= 1 && !elems)
+	return new vector_node<Elem>(NULL, length ? (Elem) elem->copy() : NULL, length);
+    array *a = new_array();
+    for (int i = 0; i < length; i++)
+	add(a, (Elem) at(i)->copy());
+    return new vector_node<Elem>(a, NULL, length);
+}
+
+
+///////////////////////////////////////////////////////////////////////////
+//
+// vector_node::len
+//
+// return the length of the vector_node
+//
+///////////////////////////////////////////////////////////////////////////
+template <class Elem> int vector_node<Elem>::len()
+{
+    return length;
+}
+
+
+///////////////////////////////////////////////////////////////////////////
+//
+// vector_node::nth_length
+//
+// return the nth element on the list
+//
+///////////////////////////////////////////////////////////////////////////
+template <class Elem> Elem vector_node<Elem>::nth_length(int n, int &len)
+{
+    len = length;
+    if (n < 0 || n >= length)
+	return NULL;
+    return at(n);
+}
+
+
+///////////////////////////////////////////////////////////////////////////
+//
+// vector_node::dump
+//
+// dump for list node, in the form of the nil, single or append node
+// that would have built the list
+//
+///////////////////////////////////////////////////////////////////////////
+template <class Elem> void vector_node<Elem>::dump(ostream& stream, int n)
+{
+    if (!elems && length == 0)
+	stream << pad(n) << "(nil)\n";
+    else if (!elems)
+	elem->dump(stream, n);
+    else {
+	stream << pad(n) << "list\n";
+	for (int i = 0; i < length; i++)
+	    at(i)->dump(stream, n+2);
+	stream << pad(n) << "(end_of_list)\n";
+    }
+}
+
+
 ///////////////////////////////////////////////////////////////////////////
 //
 // list
@@ -5,16 +5,168 @@
 #include "copyright.h"
 
 #include "cool-io.h"
-#define MAXSIZE 1000000
-#define min(a,b) (a > b ? b : a)
-
 #include "stringtab.h"
 #include <stdio.h>
+#include <algorithm>
+
+#define MAXSIZE 1000000
+
+//
+// A string table is implemented as an array of Entrys indexed by their
+// index.  Each Entry in the array has a unique string.  The entries are
+// also indexed by hash tables, so strings are found without scanning
+// the array.
+//
+
+//
+// FNV-1a hash of the first len characters of s.
+//
+inline unsigned hash_string(char *s, int len)
+{
+  unsigned hash = 2166136261u;
+  for (int i = 0; i < len; i++)
+    hash = (hash ^ (unsigned char) s[i]) * 16777619u;
+  return hash;
+}
+
+//
+// The segment of tbl holding the entry with index ind, and the position
+// of the entry in it.
+//
+inline int segment_of(int ind, int first_segment, int *offset)
+{
+  unsigned n = ind / first_segment + 1;
+  int segment = 31 - __builtin_clz(n);
+  *offset = ind - first_segment * ((1 << segment) - 1);
+  return segment;
+}
+
+template <class Elem>
+StringTable<Elem>::StringTable(): index(0), published(0)
+{
+  for (int i = 0; i < SEGMENTS; i++)
+    tbl[i].store((std::atomic<Elem *> *) NULL, std::memory_order_relaxed);
+}
+
+//
+// The entries and their strings are freed along with the arenas.
+//
+template <class Elem>
+StringTable<Elem>::~StringTable()
+{
+  for (int i = 0; i < SEGMENTS; i++)
+    delete [] tbl[i].load();
+  for (int i = 0; i < SHARDS; i++)
+    for (Index *ix = shards[i].index.load(); ix; ) {
+      Index *replaced = ix->replaced;
+      delete [] ix->slots;
+      delete [] ix->hashes;
+      delete ix;
+      ix = replaced;
+    }
+}
+
+//
+// Returns the entry with the string, or NULL if the index has none.
+// Takes no lock: a slot is only read once it is filled, and its hash is
+// written before it is.
+//
+template <class Elem>
+Elem *StringTable<Elem>::find(Index *ix, char *s, int len, unsigned hash)
+{
+  if (!ix)
+    return NULL;
+  int mask = ix->capacity - 1;
+  for (int i = hash & mask; ; i = (i + 1) & mask) {
+    Elem *e = ix->slots[i].load(std::memory_order_acquire);
+    if (!e || (ix->hashes[i] == hash && e->equal_string(s,len)))
+      return e;
+  }
+}
+
+//
+// Returns the slot holding the string, or the empty slot where it
+// belongs if it is not in the index.  Called with the shard locked.
+//
+template <class Elem>
+int StringTable<Elem>::find_slot(Index *ix, char *s, int len, unsigned hash)
+{
+  int mask = ix->capacity - 1;
+  int i = hash & mask;
+  for (Elem *e; (e = ix->slots[i].load(std::memory_order_relaxed)); i = (i + 1) & mask)
+    if (ix->hashes[i] == hash && e->equal_string(s,len))
+      break;
+  return i;
+}
 
 //
-// A string table is implemented a linked list of Entrys.  Each Entry
-// in the list has a unique string.
+// Replaces the index of the shard by one with twice the slots.  Called
+// with the shard locked.
 //
+template <class Elem>
+typename StringTable<Elem>::Index *StringTable<Elem>::grow(Shard& shard)
+{
+  Index *old = shard.index.load(std::memory_order_relaxed);
+  Index *ix = new Index;
+  ix->capacity = old ? 2 * old->capacity : MINSLOTS;
+  ix->slots = new std::atomic<Elem *>[ix->capacity]();
+  ix->hashes = new unsigned[ix->capacity];
+  ix->replaced = old;
+
+  int mask = ix->capacity - 1;
+  for (int i = 0; old && i < old->capacity; i++) {
+    Elem *e = old->slots[i].load(std::memory_order_relaxed);
+    if (e) {
+      int j = old->hashes[i] & mask;
+      while (ix->slots[j].load(std::memory_order_relaxed))
+        j = (j + 1) & mask;
+      ix->hashes[j] = old->hashes[i];
+      ix->slots[j].store(e, std::memory_order_relaxed);
+    }
+  }
+  shard.index.store(ix, std::memory_order_release);
+  return ix;
+}
+
+//
+// The slot of tbl for the entry with index ind.  If its segment is not
+// there yet, it is allocated when allocate is set, and NULL is returned
+// otherwise.  The thread that needs a segment first allocates it.
+//
+template <class Elem>
+std::atomic<Elem *> *StringTable<Elem>::slot(int ind, bool allocate)
+{
+  int offset;
+  int segment = segment_of(ind, FIRST_SEGMENT, &offset);
+  std::atomic<Elem *> *entries = tbl[segment].load(std::memory_order_acquire);
+  if (!entries) {
+    if (!allocate)
+      return NULL;
+    std::atomic<Elem *> *allocated = new std::atomic<Elem *>[FIRST_SEGMENT << segment]();
+    if (tbl[segment].compare_exchange_strong(entries, allocated))
+      entries = allocated;
+    else
+      delete [] allocated;
+  }
+  return entries + offset;
+}
+
+//
+// Stores the new entry with index ind in tbl and moves `published' over
+// it and over the entries after it that are stored already.  A thread
+// that stops at an empty slot leaves the rest to the thread storing it:
+// the stores and the loads of the slots are sequentially consistent, so
+// of two threads storing neighbouring entries at least one sees both.
+//
+template <class Elem>
+void StringTable<Elem>::publish(Elem *e, int ind)
+{
+  slot(ind, true)->store(e);
+  int p = published.load();
+  for (std::atomic<Elem *> *next; p < index.load() && (next = slot(p, false)) && next->load(); )
+    if (published.compare_exchange_weak(p, p + 1))
+      p++;
+}
 
 template <class Elem>
 Elem *StringTable<Elem>::add_string(char *s)
@@ -23,61 +175,80 @@ Elem *StringTable<Elem>::add_string(char *s)
 }
 
 //
-// Add a string requires two steps.  First, the list is searched; if the
-// string is found, a pointer to the existing Entry for that string is 
-// returned.  If the string is not found, a new Entry is created and added
-// to the list.
+// Add a string requires two steps.  First, the hash index of the shard is
+// searched; if the string is found, a pointer to the existing Entry for
+// that string is returned.  If the string is not found, the shard is
+// locked and searched again, since another thread may have added the
+// string meanwhile.  If it is still not there, a new Entry is created and
+// added to the array and to the hash index.
 //
 template <class Elem>
 Elem *StringTable<Elem>::add_string(char *s, int maxchars)
 {
-  int len = min((int) strlen(s),maxchars);
-  for(List<Elem> *l = tbl; l; l = l->tl())
-    if (l->hd()->equal_string(s,len))
-      return l->hd();
+  int len = std::min((int) strlen(s),maxchars);
+  unsigned hash = hash_string(s,len);
+  Shard& shard = shards[hash >> (32 - SHARD_BITS)];
+  Elem *e = find(shard.index.load(std::memory_order_acquire),s,len,hash);
+  if (e)
+    return e;
 
-  Elem *e = new Elem(s,len,index++);
-  tbl = new List<Elem>(e, tbl);
+  std::lock_guard<std::mutex> guard(shard.lock);
+  Index *ix = shard.index.load(std::memory_order_relaxed);
+  if (!ix || 2 * (shard.count + 1) > ix->capacity)
+    ix = grow(shard);
+  int i = find_slot(ix,s,len,hash);
+  if ((e = ix->slots[i].load(std::memory_order_relaxed)))
+    return e;
+
+  int ind = index.fetch_add(1);
+  e = new (shard.arena.allocate(sizeof(Elem))) Elem(shard.arena.copy_string(s,len),len,ind);
+  publish(e,ind);
+  ix->hashes[i] = hash;
+  ix->slots[i].store(e, std::memory_order_release);
+  shard.count++;
   return e;
 }
 
 //
-// To look up a string, the list is scanned until a matching Entry is located.
-// If no such entry is found, an assertion failure occurs.  Thus, this function
-// is used only for strings that one expects to find in the table.
+// To look up a string, the hash index is probed until a matching Entry is
+// located.  If no such entry is found, an assertion failure occurs.  Thus,
+// this function is used only for strings that one expects to find in the
+// table.
 //
 template <class Elem>
 Elem *StringTable<Elem>::lookup_string(char *s)
 {
   int len = strlen(s);
-  for(List<Elem> *l = tbl; l; l = l->tl())
-    if (l->hd()->equal_string(s,len))
-      return l->hd();
-  assert(0);   // fail if string is not found
-  return NULL; // to avoid compiler warning
+  unsigned hash = hash_string(s,len);
+  Shard& shard = shards[hash >> (32 - SHARD_BITS)];
+  Elem *e = find(shard.index.load(std::memory_order_acquire),s,len,hash);
+  assert(e);   // fail if string is not found
+  return e;
 }
 
 //
 // lookup is similar to lookup_string, but uses the index of the string
-// as the key.
+// as the key.  The index is the position of the Entry in the array.  The
+// indices below `published' and those of entries returned by add_string
+// are always found; other entries may still be on their way.
 //
 template <class Elem>
 Elem *StringTable<Elem>::lookup(int ind)
 {
-  for(List<Elem> *l = tbl; l; l = l->tl())
-    if (l->hd()->equal_index(ind))
-      return l->hd();
-  assert(0);   // fail if string is not found
-  return NULL; // to avoid compiler warning
+  assert(0 <= ind && ind < index);   // fail if string is not found
+  std::atomic<Elem *> *entry = slot(ind, false);
+  Elem *e = entry ? entry->load(std::memory_order_acquire) : NULL;
+  assert(e);
+  return e;
 }
 
 //
-// add_int adds the string representation of an integer to the list.
+// add_int adds the string representation of an integer to the table.
 //
 template <class Elem>
 Elem *StringTable<Elem>::add_int(int i)
 {
-  static char *buf = new char[20];
+  char buf[20];
   snprintf(buf, 20, "%d", i);
   return add_string(buf);
 }
@@ -90,18 +261,45 @@ int StringTable<Elem>::first()
 template <class Elem>
 int StringTable<Elem>::more(int i)
 {
-  return i < index;
+  return i < published.load(std::memory_order_acquire);
 }
 
 template <class Elem>
 int StringTable<Elem>::next(int i)
 {
-  assert(i < index);
+  assert(i < published);
   return i+1;
 }
 
 template <class Elem>
 void StringTable<Elem>::print()
 {
-  list_print(cerr,tbl);
+  cerr << "[\n";
+  for (int i = published - 1; i >= 0; i--)
+    cerr << *lookup(i) << " ";
+  cerr << "]\n";
+}
+
+template <class Elem>
+void StringTable<Elem>::print_stats(ostream& s, const char *name)
+{
+  long allocations = 0;
+  size_t used = 0, reserved = 0, index_bytes = 0;
+  int blocks = 0;
+  for (int i = 0; i < SHARDS; i++) {
+    Shard& shard = shards[i];
+    std::lock_guard<std::mutex> guard(shard.lock);
+    allocations += shard.arena.allocation_count();
+    used += shard.arena.bytes_used();
+    reserved += shard.arena.bytes_reserved();
+    blocks += shard.arena.block_count();
+    for (Index *ix = shard.index.load(); ix; ix = ix->replaced)
+      index_bytes += ix->capacity * (sizeof(Elem *) + sizeof(unsigned));
+  }
+  for (int i = 0; i < SEGMENTS; i++)
+    if (tbl[i].load())
+      index_bytes += (FIRST_SEGMENT << i) * sizeof(std::atomic<Elem *>);
+  s << name << ": " << index << " entries, " << allocations << " allocations, "
+    << used << " bytes used, " << reserved << " bytes in " << blocks
+    << " blocks, " << index_bytes << " bytes of index\n";
 }
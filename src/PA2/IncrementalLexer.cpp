@@ -0,0 +1,87 @@
+#include "IncrementalLexer.h"
+#include <algorithm>
+#include <iterator>
+#include <stdexcept>
+
+IncrementalLexer::IncrementalLexer(std::string text) : program(std::move(text)) {
+    Lexer lexer(Source::borrow(program));
+    while (lexer.hasNext()) {
+        stream.push_back(lexer.next());
+    }
+}
+
+IncrementalLexer::Change IncrementalLexer::apply(const Edit& edit) {
+    if (edit.offset > program.size() || edit.deletedLength > program.size() - edit.offset) {
+        throw std::runtime_error("Edit is outside of the program text");
+    }
+
+    // A token is decided by its bytes and the one byte after it, so every token ending before the edit
+    // is unaffected. Between tokens the lexer is outside of any comment, so it can restart right there.
+    auto first = std::partition_point(stream.begin(), stream.end(), [&edit](const Token& token) {
+        return token.getOffset() + token.getLength() < edit.offset;
+    }) - stream.begin();
+    std::size_t restart = first == 0 ? 0 : stream[first - 1].getOffset() + stream[first - 1].getLength();
+    std::size_t line = first == 0 ? 1 : stream[first - 1].getLine();
+
+    auto previous = reinterpret_cast<std::uintptr_t>(program.data());
+    auto previousSize = program.size();
+    program.replace(edit.offset, edit.deletedLength, edit.insertedText);
+    auto delta = static_cast<std::ptrdiff_t>(edit.insertedText.size()) - static_cast<std::ptrdiff_t>(edit.deletedLength);
+    auto editEnd = edit.offset + edit.insertedText.size();
+
+    Lexer lexer(Source::borrow(program));
+    lexer.offset = restart;
+    lexer.lineNumber = line;
+    std::vector<Token> relexed;
+    // Once a new token past the edit starts where an old one did, both lexers are in the same state on the
+    // same remaining text: the rest of the old stream is kept, shifted by the size of the edit
+    auto kept = static_cast<std::size_t>(first);
+    auto resynchronized = false;
+    std::ptrdiff_t lineDelta = 0;
+    while (lexer.hasNext()) {
+        auto token = lexer.next();
+        if (token.getOffset() >= editEnd) {
+            auto previousOffset = token.getOffset() - delta;
+            while (kept < stream.size() && stream[kept].getOffset() < previousOffset) kept++;
+            if (kept < stream.size() && stream[kept].getOffset() == previousOffset) {
+                lineDelta = static_cast<std::ptrdiff_t>(token.getLine()) - static_cast<std::ptrdiff_t>(stream[kept].getLine());
+                resynchronized = true;
+                break;
+            }
+        }
+        relexed.push_back(std::move(token));
+    }
+    if (!resynchronized) kept = stream.size();
+
+    for (auto i = kept; i < stream.size(); i++) {
+        relocate(stream[i], previous, previousSize, delta, lineDelta);
+    }
+    if (reinterpret_cast<std::uintptr_t>(program.data()) != previous) {
+        for (std::size_t i = 0; i < static_cast<std::size_t>(first); i++) {
+            relocate(stream[i], previous, previousSize, 0, 0);
+        }
+    }
+
+    Change change{static_cast<std::size_t>(first), kept - first, relexed.size()};
+    auto reused = std::min(change.removed, change.inserted);
+    std::move(relexed.begin(), relexed.begin() + reused, stream.begin() + first);
+    if (change.inserted > reused) {
+        stream.insert(stream.begin() + first + reused, std::make_move_iterator(relexed.begin() + reused),
+                      std::make_move_iterator(relexed.end()));
+    } else {
+        stream.erase(stream.begin() + first + reused, stream.begin() + kept);
+    }
+    return change;
+}
+
+void IncrementalLexer::relocate(Token& token, std::uintptr_t previous, std::size_t previousSize, std::ptrdiff_t delta,
+                                std::ptrdiff_t lineDelta) const {
+    token.setLine(token.getLine() + lineDelta);
+    token.setSpan(token.getOffset() + delta, token.getLength());
+    auto lexeme = token.getLexeme();
+    auto address = reinterpret_cast<std::uintptr_t>(lexeme.data());
+    // owned lexemes and literals like "true" stay where they are, views of the previous text are moved
+    if (!lexeme.empty() && address >= previous && address < previous + previousSize) {
+        token.setLexeme(std::string_view(program).substr(address - previous + delta, lexeme.size()));
+    }
+}
@@ -1,31 +1,95 @@
 #include "Lexer.h"
+#include "Scan.h"
 #include "Utils.h"
+#include <cctype>
+#include <cstdint>
 
 bool Lexer::hasNext() {
-    if (isAtEnd()) return false;
     while (!isAtEnd()) {
-        if (peek() == '-' && peekNext() == '-') {
-            while (peek() != '\n' && !isAtEnd()) advance();
-        }
-        if (peek() == '(' && peekNext() == '*') {
+        auto c = peek();
+        if (isWhitespace(c)) {
             advance();
+            // most runs are a single space, the kernel only pays off on indentation and blank lines
+            if (isWhitespace(peek())) skipTo(skipWhitespace(current(), end()));
+        } else if (c == '-' && peekNext() == '-') {
+            skipTo(findNewline(current(), end()));
+        } else if (c == '(' && peekNext() == '*') {
             if (!tryToSkipMultiLineComment()) return true;
+        } else {
+            return true;
         }
-        if (isAtEnd()) return false;
-        if (!isWhitespace(peek())) return true;
-        advance();
     }
-    return !isAtEnd();
+    return false;
 }
 
 Token Lexer::next() {
+    while (!isAtEnd() && isWhitespace(peek())) advance();
+    auto begin = offset;
+    auto raw = scan();
+    auto token = raw.kind == Token::Kind::ATOM ? Token(raw.text, lineNumber)
+                 : isScratch(raw.text) ? Token::owning(raw.kind, std::string(raw.text), lineNumber)
+                 : Token(raw.kind, raw.text, lineNumber);
+    token.setSpan(begin, offset - begin);
+    return token;
+}
+
+void Lexer::lex(TokenHandler& handler) {
+    while (hasNext()) {
+        // hasNext() stops on the first byte of a token, so scan() doesn't skip whitespace again
+        auto begin = offset;
+        auto raw = scan();
+        if (raw.kind == Token::Kind::ERROR) {
+            handler.onError(raw.text, begin, offset - begin, lineNumber);
+        } else {
+            handler.onToken(raw.kind, raw.text, begin, offset - begin, lineNumber);
+        }
+    }
+}
+
+TokenBuffer Lexer::tokenizeAll() {
+    if (program.size() > UINT32_MAX) throw std::runtime_error("Program is too large to be tokenized at once");
+
+    TokenBuffer buffer(program);
+    // the examples average 6 bytes per token
+    buffer.reserve((program.size() - offset) / 6 + 16);
+    while (hasNext()) {
+        // hasNext() stops on the first byte of a token, so scan() doesn't skip whitespace again
+        auto begin = offset;
+        auto raw = scan();
+        if (raw.kind == Token::Kind::ERROR || isScratch(raw.text)) {
+            buffer.pushOwned(raw.kind, begin, offset - begin, lineNumber, raw.text);
+        } else {
+            buffer.push(raw.kind, begin, offset - begin, lineNumber);
+        }
+    }
+
+    if (lines == LineTracking::DEFERRED) {
+        // offsets are ascending, so the lines are resolved in a single walk over the line starts
+        if (!lineIndex) lineIndex = std::make_unique<LineIndex>(program);
+        std::size_t line = 1;
+        for (std::size_t i = 0; i < buffer.size(); i++) {
+            auto end = buffer.offsets[i] + buffer.lengths[i];
+            while (line < lineIndex->lineCount() && lineIndex->lineStart(line + 1) <= end) line++;
+            buffer.lines[i] = static_cast<std::uint32_t>(line);
+        }
+    }
+    return buffer;
+}
+
+std::size_t Lexer::lineOf(const Token& token) {
+    if (lines == LineTracking::EAGER) return token.getLine();
+    if (!lineIndex) lineIndex = std::make_unique<LineIndex>(program);
+    // tokens report the line they end on, like the reference lexer
+    return lineIndex->line(token.getOffset() + token.getLength());
+}
+
+Lexer::RawToken Lexer::scan() {
     if (isAtEnd() && comments != 0) {
-        return {Token::Kind::ERROR, "EOF in comment", lineNumber};
+        return {Token::Kind::ERROR, "EOF in comment"};
     }
 
-    while (!isAtEnd()) {
+    if (!isAtEnd()) {
         auto c = advance();
-        if (isWhitespace(c)) continue;
         switch (c) {
             case '{':
             case '}':
@@ -40,28 +104,28 @@ Token Lexer::next() {
             case ',':
             case '@':
             case '~':
-                return {std::string(1, c), lineNumber};
+                return {Token::Kind::ATOM, program.substr(offset - 1, 1)};
 
             case '=':
                 if (match('>')) {
-                    return {Token::Kind::DARROW, lineNumber};
+                    return {Token::Kind::DARROW, {}};
                 } else {
-                    return {std::string(1, c), lineNumber};
+                    return {Token::Kind::ATOM, program.substr(offset - 1, 1)};
                 }
             case '*':
                 if (match(')')) {
-                    return {Token::Kind::ERROR, "Unmatched *)", lineNumber};
+                    return {Token::Kind::ERROR, "Unmatched *)"};
                 } else {
-                    return {std::string(1, c), lineNumber};
+                    return {Token::Kind::ATOM, program.substr(offset - 1, 1)};
                 }
 
             case '<':
                 if (match('-')) {
-                    return {Token::Kind::ASSIGN, lineNumber};
+                    return {Token::Kind::ASSIGN, {}};
                 } else if (match('=')) {
-                    return {Token::Kind::LE, lineNumber};
+                    return {Token::Kind::LE, {}};
                 } else {
-                    return {std::string(1, c), lineNumber};
+                    return {Token::Kind::ATOM, program.substr(offset - 1, 1)};
                 }
             case '"': return string();
             default:
@@ -70,7 +134,9 @@ Token Lexer::next() {
                 } else if (isAlpha(c)) {
                     return identifier();
                 } else {
-                    return {Token::Kind::ERROR, charToStringRepresentation(c), lineNumber};
+                    scratch.clear();
+                    appendCharRepresentation(scratch, c);
+                    return {Token::Kind::ERROR, scratch};
                 }
         }
     }
@@ -79,23 +145,24 @@ Token Lexer::next() {
 }
 
 char Lexer::advance() {
-    if (program.at(offset) == '\n') lineNumber++;
-    return program.at(offset++);
+    auto c = program[offset++];
+    if (lines == LineTracking::EAGER && hasClass(c, NEWLINE)) lineNumber++;
+    return c;
 }
 
 char Lexer::peek() {
     if (isAtEnd()) return '\0';
-    return program.at(offset);
+    return program[offset];
 }
 
 char Lexer::peekNext() {
     if (offset + 1 >= program.length()) return '\0';
-    return program.at(offset + 1);
+    return program[offset + 1];
 }
 
 bool Lexer::match(char expected) {
     if (isAtEnd()) return false;
-    if (program.at(offset) != expected) return false;
+    if (program[offset] != expected) return false;
 
     advance();
     return true;
@@ -105,99 +172,172 @@ bool Lexer::isAtEnd() {
     return offset >= program.length();
 }
 
-Token Lexer::string() {
+void Lexer::skipTo(const char* position) {
+    if (lines == LineTracking::EAGER) lineNumber += countNewlines(current(), position);
+    offset = position - program.data();
+}
+
+Lexer::RawToken Lexer::string() {
+    auto begin = offset - 1;
     std::size_t size = 0;
-    std::stringstream result;
-    result << '"';
-    char c;
-    while ((c = peek()) != '"' && !isAtEnd()) {
+    // Strings are copied into the scratch buffer only once their representation starts to differ from the
+    // program text. Runs of ordinary characters are found with a scan kernel and copied at once.
+    bool clean = true;
+    auto materialize = [&]() {
+        if (!clean) return;
+        // a printed character takes at most 12 bytes, most strings fit without growing
+        scratch.reserve(2 * MAX_STR_LENGTH + 2);
+        scratch.assign(program.substr(begin, offset - begin));
+        clean = false;
+    };
+    while (true) {
+        // runs hold no newlines, so the line number stays as it is
+        auto special = findStringSpecial(current(), end());
+        auto run = static_cast<std::size_t>(special - current());
+        // once a string is too long it is only scanned for its end
+        if (!clean && size <= MAX_STR_LENGTH) scratch.append(current(), run);
+        size += run;
+        offset += run;
+        if (isAtEnd()) return {Token::Kind::ERROR, "EOF in string constant"};
+
+        auto c = peek();
+        if (c == '"') break;
         if (c == '\\') {
             auto next = peekNext();
             if (next == 'b' || next == 't' || next == 'n' || next == 'f' || next == '\\' || next == '"' || next == '\n') {
-                next == '\n' ? result << "\\n" : result << '\\' << next;
+                if (next == '\n') {
+                    materialize();
+                    scratch += "\\n";
+                } else if (!clean) {
+                    scratch += '\\';
+                    scratch += next;
+                }
                 size++;
                 advance();
+            } else if (next != '\0') {
+                materialize(); // backslash before an ordinary character is dropped
             }
             if (next == '\0') {
                 advance();
-                return {Token::Kind::ERROR, "String contains escaped null character.", lineNumber};
+                return {Token::Kind::ERROR, "String contains escaped null character."};
             }
         } else if (c == '\n') {
             advance();
-            return {Token::Kind::ERROR, "Unterminated string constant", lineNumber};
+            return {Token::Kind::ERROR, "Unterminated string constant"};
         } else if (c == '\0') {
             while (peek() != '"' && peek() != '\n' && !isAtEnd()) advance();
             if (peek() == '"') advance();
-            return {Token::Kind::ERROR, "String contains null character.", lineNumber};
+            return {Token::Kind::ERROR, "String contains null character."};
         } else {
-            result << charToStringRepresentation(c);
+            // other control characters and bytes above 127
+            materialize();
+            appendCharRepresentation(scratch, c);
             size++;
         }
         advance();
     }
-    if (isAtEnd()) return {Token::Kind::ERROR, "EOF in string constant", lineNumber};
 
     advance(); // skip enclosing '"'
-    result << '"';
-    if (size > MAX_STR_LENGTH) return {Token::Kind::ERROR, "String constant too long", lineNumber};
-    return {Token::Kind::STR_CONST, result.str(), lineNumber};
+    if (size > MAX_STR_LENGTH) return {Token::Kind::ERROR, "String constant too long"};
+    if (clean) return {Token::Kind::STR_CONST, program.substr(begin, offset - begin)};
+    scratch += '"';
+    return {Token::Kind::STR_CONST, scratch};
 }
 
-Token Lexer::number() {
+Lexer::RawToken Lexer::number() {
     auto begin = offset - 1;
-    while (isDigit(peek()) && !isAtEnd()) advance();
-    return {Token::Kind::INT_CONST, program.substr(begin, offset - begin), lineNumber};
+    while (offset < program.size() && isDigit(program[offset])) offset++;
+    return {Token::Kind::INT_CONST, program.substr(begin, offset - begin)};
 }
 
-Token Lexer::identifier() {
+Lexer::RawToken Lexer::identifier() {
     auto begin = offset - 1;
-    while (isAlphaOdDigitOrUnderscore(peek()) && !isAtEnd()) advance();
+    while (offset < program.size() && isAlphaOdDigitOrUnderscore(program[offset])) offset++;
 
     auto text = program.substr(begin, offset - begin);
     // BOOL_CONST | OBJECTID | TYPEID | keyword
     Token::Kind type = getKeywordType(text);
     if (type == Token::Kind::BOOL_CONST) {
-        return {islower(text[0]) ? Token::Kind::BOOL_CONST : Token::Kind::TYPEID, islower(text[0]) ? toLowerCase(text) : text, lineNumber};
+        if (!islower(text[0])) return {Token::Kind::TYPEID, text};
+        return {Token::Kind::BOOL_CONST, text.size() == 4 ? "true" : "false"};
     } else if (type != Token::Kind::ERROR) {
-        return {type, lineNumber};
+        return {type, {}};
     }
 
-    return {islower(text[0]) ? Token::Kind::OBJECTID : Token::Kind::TYPEID, text, lineNumber};
-}
-
-Token::Kind Lexer::getKeywordType(const std::string& str) {
-    auto lowercaseStr = toLowerCase(str);
-    if (lowercaseStr == "class") return Token::Kind::CLASS;
-    if (lowercaseStr == "else") return Token::Kind::ELSE;
-    if (lowercaseStr == "fi") return Token::Kind::FI;
-    if (lowercaseStr == "if") return Token::Kind::IF;
-    if (lowercaseStr == "in") return Token::Kind::IN;
-    if (lowercaseStr == "inherits") return Token::Kind::INHERITS;
-    if (lowercaseStr == "let") return Token::Kind::LET;
-    if (lowercaseStr == "loop") return Token::Kind::LOOP;
-    if (lowercaseStr == "pool") return Token::Kind::POOL;
-    if (lowercaseStr == "then") return Token::Kind::THEN;
-    if (lowercaseStr == "while") return Token::Kind::WHILE;
-    if (lowercaseStr == "case") return Token::Kind::CASE;
-    if (lowercaseStr == "esac") return Token::Kind::ESAC;
-    if (lowercaseStr == "of") return Token::Kind::OF;
-    if (lowercaseStr == "new") return Token::Kind::NEW;
-    if (lowercaseStr == "isvoid") return Token::Kind::ISVOID;
-    if (lowercaseStr == "not") return Token::Kind::NOT;
-    if (lowercaseStr == "true" || lowercaseStr == "false") return Token::Kind::BOOL_CONST;
-    return Token::Kind::ERROR;
+    return {islower(text[0]) ? Token::Kind::OBJECTID : Token::Kind::TYPEID, text};
+}
+
+Token::Kind Lexer::getKeywordType(std::string_view str) {
+    // Keywords are bucketed by length and first letter, so an identifier is compared with at most
+    // three candidates in place instead of being lowercased and tested against every keyword
+    if (str.empty()) return Token::Kind::ERROR;
+    auto first = static_cast<char>(str[0] | 0x20);
+    switch (str.size()) {
+        case 2:
+            switch (first) {
+                case 'f': return equalsIgnoreCase(str, "fi") ? Token::Kind::FI : Token::Kind::ERROR;
+                case 'i':
+                    if (equalsIgnoreCase(str, "if")) return Token::Kind::IF;
+                    if (equalsIgnoreCase(str, "in")) return Token::Kind::IN;
+                    return Token::Kind::ERROR;
+                case 'o': return equalsIgnoreCase(str, "of") ? Token::Kind::OF : Token::Kind::ERROR;
+                default: return Token::Kind::ERROR;
+            }
+        case 3:
+            switch (first) {
+                case 'l': return equalsIgnoreCase(str, "let") ? Token::Kind::LET : Token::Kind::ERROR;
+                case 'n':
+                    if (equalsIgnoreCase(str, "new")) return Token::Kind::NEW;
+                    if (equalsIgnoreCase(str, "not")) return Token::Kind::NOT;
+                    return Token::Kind::ERROR;
+                default: return Token::Kind::ERROR;
+            }
+        case 4:
+            switch (first) {
+                case 'c': return equalsIgnoreCase(str, "case") ? Token::Kind::CASE : Token::Kind::ERROR;
+                case 'e':
+                    if (equalsIgnoreCase(str, "else")) return Token::Kind::ELSE;
+                    if (equalsIgnoreCase(str, "esac")) return Token::Kind::ESAC;
+                    return Token::Kind::ERROR;
+                case 'l': return equalsIgnoreCase(str, "loop") ? Token::Kind::LOOP : Token::Kind::ERROR;
+                case 'p': return equalsIgnoreCase(str, "pool") ? Token::Kind::POOL : Token::Kind::ERROR;
+                case 't':
+                    if (equalsIgnoreCase(str, "then")) return Token::Kind::THEN;
+                    if (equalsIgnoreCase(str, "true")) return Token::Kind::BOOL_CONST;
+                    return Token::Kind::ERROR;
+                default: return Token::Kind::ERROR;
+            }
+        case 5:
+            switch (first) {
+                case 'c': return equalsIgnoreCase(str, "class") ? Token::Kind::CLASS : Token::Kind::ERROR;
+                case 'f': return equalsIgnoreCase(str, "false") ? Token::Kind::BOOL_CONST : Token::Kind::ERROR;
+                case 'w': return equalsIgnoreCase(str, "while") ? Token::Kind::WHILE : Token::Kind::ERROR;
+                default: return Token::Kind::ERROR;
+            }
+        case 6: return equalsIgnoreCase(str, "isvoid") ? Token::Kind::ISVOID : Token::Kind::ERROR;
+        case 8: return equalsIgnoreCase(str, "inherits") ? Token::Kind::INHERITS : Token::Kind::ERROR;
+        default: return Token::Kind::ERROR;
+    }
 }
 
 bool Lexer::tryToSkipMultiLineComment() {
+    // Both delimiters are consumed as a whole, so "(*)" opens a comment without closing it
+    advance();
+    advance();
     comments = 1;
     while (comments != 0 && !isAtEnd()) {
-        if (peek() == '*' && peekNext() == ')') comments--;
-        if (peek() == '(' && peekNext() == '*') comments++;
+        if (peek() != '(' && peek() != '*') {
+            skipTo(findCommentDelimiter(current(), end()));
+            continue;
+        }
+        if (peek() == '*' && peekNext() == ')') {
+            comments--;
+            advance();
+        } else if (peek() == '(' && peekNext() == '*') {
+            comments++;
+            advance();
+        }
         advance();
     }
-    if (isAtEnd()) {
-        return false;
-    }
-    advance(); // skip last ')'
-    return true;
+    return comments == 0;
 }
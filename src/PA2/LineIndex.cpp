@@ -0,0 +1,21 @@
+#include "LineIndex.h"
+#include "Scan.h"
+#include <algorithm>
+
+LineIndex::LineIndex(std::string_view text) {
+    auto begin = text.data();
+    auto end = begin + text.size();
+    starts.reserve(countNewlines(begin, end) + 1);
+    starts.push_back(0);
+    for (auto position = findNewline(begin, end); position != end; position = findNewline(position + 1, end)) {
+        starts.push_back(position + 1 - begin);
+    }
+}
+
+std::size_t LineIndex::line(std::size_t offset) const {
+    return std::upper_bound(starts.begin(), starts.end(), offset) - starts.begin();
+}
+
+std::size_t LineIndex::column(std::size_t offset) const {
+    return offset - starts[line(offset) - 1] + 1;
+}
@@ -0,0 +1,244 @@
+#include "Scan.h"
+#include "Utils.h"
+#include <cstdlib>
+#include <cstring>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__)) && defined(__SSE2__)
+#define COOL_SCAN_X86 1
+#include <immintrin.h>
+#endif
+
+// The narrower kernels are inlined into the wider ones as their tails. Calling them instead would run
+// legacy SSE code with dirty upper AVX state, which stalls on every transition.
+#define INLINE_KERNEL static inline __attribute__((always_inline))
+
+INLINE_KERNEL const char* scalarSkipWhitespace(const char* begin, const char* end) {
+    while (begin < end && isWhitespace(*begin)) begin++;
+    return begin;
+}
+
+INLINE_KERNEL const char* scalarFindNewline(const char* begin, const char* end) {
+    while (begin < end && *begin != '\n') begin++;
+    return begin;
+}
+
+INLINE_KERNEL const char* scalarFindCommentDelimiter(const char* begin, const char* end) {
+    while (begin < end && *begin != '(' && *begin != '*') begin++;
+    return begin;
+}
+
+INLINE_KERNEL const char* scalarFindStringSpecial(const char* begin, const char* end) {
+    while (begin < end && static_cast<signed char>(*begin) >= 32 && *begin != '"' && *begin != '\\') begin++;
+    return begin;
+}
+
+INLINE_KERNEL std::size_t scalarCountNewlines(const char* begin, const char* end) {
+    std::size_t count = 0;
+    for (; begin < end; begin++) count += *begin == '\n';
+    return count;
+}
+
+#ifdef COOL_SCAN_X86
+
+// 0xFF for ' ' and '\t'..'\r'. SSE2 has no unsigned byte comparison, so c - 9 <= 4 is checked as min(c - 9, 4) == c - 9
+INLINE_KERNEL __m128i whitespaceMask(__m128i chunk) {
+    auto shifted = _mm_sub_epi8(chunk, _mm_set1_epi8(9));
+    auto control = _mm_cmpeq_epi8(_mm_min_epu8(shifted, _mm_set1_epi8(4)), shifted);
+    return _mm_or_si128(control, _mm_cmpeq_epi8(chunk, _mm_set1_epi8(' ')));
+}
+
+INLINE_KERNEL const char* sse2SkipWhitespace(const char* begin, const char* end) {
+    for (; end - begin >= 16; begin += 16) {
+        auto chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(begin));
+        auto mask = ~static_cast<unsigned>(_mm_movemask_epi8(whitespaceMask(chunk))) & 0xFFFFu;
+        if (mask != 0) return begin + __builtin_ctz(mask);
+    }
+    return scalarSkipWhitespace(begin, end);
+}
+
+INLINE_KERNEL const char* sse2FindNewline(const char* begin, const char* end) {
+    auto newline = _mm_set1_epi8('\n');
+    for (; end - begin >= 16; begin += 16) {
+        auto chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(begin));
+        auto mask = static_cast<unsigned>(_mm_movemask_epi8(_mm_cmpeq_epi8(chunk, newline)));
+        if (mask != 0) return begin + __builtin_ctz(mask);
+    }
+    return scalarFindNewline(begin, end);
+}
+
+INLINE_KERNEL const char* sse2FindCommentDelimiter(const char* begin, const char* end) {
+    auto open = _mm_set1_epi8('(');
+    auto star = _mm_set1_epi8('*');
+    for (; end - begin >= 16; begin += 16) {
+        auto chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(begin));
+        auto found = _mm_or_si128(_mm_cmpeq_epi8(chunk, open), _mm_cmpeq_epi8(chunk, star));
+        auto mask = static_cast<unsigned>(_mm_movemask_epi8(found));
+        if (mask != 0) return begin + __builtin_ctz(mask);
+    }
+    return scalarFindCommentDelimiter(begin, end);
+}
+
+// Control and non-ASCII bytes are exactly the ones below 32 in a signed comparison
+INLINE_KERNEL const char* sse2FindStringSpecial(const char* begin, const char* end) {
+    auto quote = _mm_set1_epi8('"');
+    auto backslash = _mm_set1_epi8('\\');
+    auto space = _mm_set1_epi8(' ');
+    for (; end - begin >= 16; begin += 16) {
+        auto chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(begin));
+        auto found = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(chunk, quote), _mm_cmpeq_epi8(chunk, backslash)),
+                                  _mm_cmplt_epi8(chunk, space));
+        auto mask = static_cast<unsigned>(_mm_movemask_epi8(found));
+        if (mask != 0) return begin + __builtin_ctz(mask);
+    }
+    return scalarFindStringSpecial(begin, end);
+}
+
+// Matches are accumulated as per-byte counters (cmpeq gives -1) and summed with psadbw before they can overflow
+INLINE_KERNEL std::size_t sse2CountNewlines(const char* begin, const char* end) {
+    auto newline = _mm_set1_epi8('\n');
+    std::size_t count = 0;
+    while (end - begin >= 16) {
+        auto counters = _mm_setzero_si128();
+        for (int i = 0; i < 255 && end - begin >= 16; i++, begin += 16) {
+            auto chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(begin));
+            counters = _mm_sub_epi8(counters, _mm_cmpeq_epi8(chunk, newline));
+        }
+        auto sums = _mm_sad_epu8(counters, _mm_setzero_si128());
+        count += _mm_cvtsi128_si32(sums) + _mm_cvtsi128_si32(_mm_unpackhi_epi64(sums, sums));
+    }
+    return count + scalarCountNewlines(begin, end);
+}
+
+__attribute__((target("avx2")))
+INLINE_KERNEL __m256i whitespaceMask(__m256i chunk) {
+    auto shifted = _mm256_sub_epi8(chunk, _mm256_set1_epi8(9));
+    auto control = _mm256_cmpeq_epi8(_mm256_min_epu8(shifted, _mm256_set1_epi8(4)), shifted);
+    return _mm256_or_si256(control, _mm256_cmpeq_epi8(chunk, _mm256_set1_epi8(' ')));
+}
+
+__attribute__((target("avx2")))
+static const char* avx2SkipWhitespace(const char* begin, const char* end) {
+    for (; end - begin >= 32; begin += 32) {
+        auto chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(begin));
+        auto mask = ~static_cast<unsigned>(_mm256_movemask_epi8(whitespaceMask(chunk)));
+        if (mask != 0) return begin + __builtin_ctz(mask);
+    }
+    return sse2SkipWhitespace(begin, end);
+}
+
+__attribute__((target("avx2")))
+static const char* avx2FindNewline(const char* begin, const char* end) {
+    auto newline = _mm256_set1_epi8('\n');
+    for (; end - begin >= 32; begin += 32) {
+        auto chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(begin));
+        auto mask = static_cast<unsigned>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(chunk, newline)));
+        if (mask != 0) return begin + __builtin_ctz(mask);
+    }
+    return sse2FindNewline(begin, end);
+}
+
+__attribute__((target("avx2")))
+static const char* avx2FindCommentDelimiter(const char* begin, const char* end) {
+    auto open = _mm256_set1_epi8('(');
+    auto star = _mm256_set1_epi8('*');
+    for (; end - begin >= 32; begin += 32) {
+        auto chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(begin));
+        auto found = _mm256_or_si256(_mm256_cmpeq_epi8(chunk, open), _mm256_cmpeq_epi8(chunk, star));
+        auto mask = static_cast<unsigned>(_mm256_movemask_epi8(found));
+        if (mask != 0) return begin + __builtin_ctz(mask);
+    }
+    return sse2FindCommentDelimiter(begin, end);
+}
+
+__attribute__((target("avx2")))
+static const char* avx2FindStringSpecial(const char* begin, const char* end) {
+    auto quote = _mm256_set1_epi8('"');
+    auto backslash = _mm256_set1_epi8('\\');
+    auto space = _mm256_set1_epi8(' ');
+    for (; end - begin >= 32; begin += 32) {
+        auto chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(begin));
+        auto found = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(chunk, quote), _mm256_cmpeq_epi8(chunk, backslash)),
+                                     _mm256_cmpgt_epi8(space, chunk));
+        auto mask = static_cast<unsigned>(_mm256_movemask_epi8(found));
+        if (mask != 0) return begin + __builtin_ctz(mask);
+    }
+    return sse2FindStringSpecial(begin, end);
+}
+
+__attribute__((target("avx2")))
+static std::size_t avx2CountNewlines(const char* begin, const char* end) {
+    auto newline = _mm256_set1_epi8('\n');
+    std::size_t count = 0;
+    while (end - begin >= 32) {
+        auto counters = _mm256_setzero_si256();
+        for (int i = 0; i < 255 && end - begin >= 32; i++, begin += 32) {
+            auto chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(begin));
+            counters = _mm256_sub_epi8(counters, _mm256_cmpeq_epi8(chunk, newline));
+        }
+        auto sums = _mm256_sad_epu8(counters, _mm256_setzero_si256());
+        alignas(32) unsigned long long lanes[4];
+        _mm256_store_si256(reinterpret_cast<__m256i*>(lanes), sums);
+        count += lanes[0] + lanes[1] + lanes[2] + lanes[3];
+    }
+    return count + sse2CountNewlines(begin, end);
+}
+
+#endif
+
+struct ScanKernels {
+    const char* name;
+    const char* (*skipWhitespace)(const char*, const char*);
+    const char* (*findNewline)(const char*, const char*);
+    const char* (*findCommentDelimiter)(const char*, const char*);
+    const char* (*findStringSpecial)(const char*, const char*);
+    std::size_t (*countNewlines)(const char*, const char*);
+};
+
+// COOL_SCAN_KERNEL=scalar|sse2 forces a weaker kernel set, e.g. to test the fallbacks on an AVX2 machine
+static ScanKernels selectKernels() {
+    ScanKernels scalar = {"scalar", scalarSkipWhitespace, scalarFindNewline, scalarFindCommentDelimiter,
+                            scalarFindStringSpecial, scalarCountNewlines};
+    auto requested = std::getenv("COOL_SCAN_KERNEL");
+    if (requested != nullptr && std::strcmp(requested, "scalar") == 0) return scalar;
+#ifdef COOL_SCAN_X86
+    ScanKernels sse2 = {"sse2", sse2SkipWhitespace, sse2FindNewline, sse2FindCommentDelimiter,
+                          sse2FindStringSpecial, sse2CountNewlines};
+    if (requested != nullptr && std::strcmp(requested, "sse2") == 0) return sse2;
+    if (__builtin_cpu_supports("avx2")) {
+        return {"avx2", avx2SkipWhitespace, avx2FindNewline, avx2FindCommentDelimiter,
+                avx2FindStringSpecial, avx2CountNewlines};
+    }
+    return sse2;
+#else
+    return scalar;
+#endif
+}
+
+static const ScanKernels& kernels() {
+    static const ScanKernels selected = selectKernels();
+    return selected;
+}
+
+const char* skipWhitespace(const char* begin, const char* end) {
+    return kernels().skipWhitespace(begin, end);
+}
+
+const char* findNewline(const char* begin, const char* end) {
+    return kernels().findNewline(begin, end);
+}
+
+const char* findCommentDelimiter(const char* begin, const char* end) {
+    return kernels().findCommentDelimiter(begin, end);
+}
+
+const char* findStringSpecial(const char* begin, const char* end) {
+    return kernels().findStringSpecial(begin, end);
+}
+
+std::size_t countNewlines(const char* begin, const char* end) {
+    return kernels().countNewlines(begin, end);
+}
+
+const char* scanKernelName() {
+    return kernels().name;
+}
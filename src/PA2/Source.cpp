@@ -0,0 +1,95 @@
+#include "Source.h"
+#include <stdexcept>
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+Source::Source(std::string text) : owned(std::make_unique<std::string>(std::move(text))) {
+    data = owned->data();
+    size = owned->size();
+}
+
+Source::Source(Source&& other) noexcept
+    : data(other.data), size(other.size), mapped(other.mapped), owned(std::move(other.owned)) {
+    other.data = "";
+    other.size = 0;
+    other.mapped = false;
+}
+
+Source& Source::operator=(Source&& other) noexcept {
+    if (this != &other) {
+        release();
+        data = other.data;
+        size = other.size;
+        mapped = other.mapped;
+        owned = std::move(other.owned);
+        other.data = "";
+        other.size = 0;
+        other.mapped = false;
+    }
+    return *this;
+}
+
+Source::~Source() {
+    release();
+}
+
+void Source::release() {
+    if (mapped) munmap(const_cast<char*>(data), size);
+    mapped = false;
+}
+
+Source Source::fromFile(const std::string& fileName) {
+    int fd = open(fileName.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw std::runtime_error("File " + fileName + " wasn't found");
+    }
+
+    struct stat info{};
+    if (fstat(fd, &info) == 0 && S_ISREG(info.st_mode) && info.st_size > 0) {
+        void* region = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (region != MAP_FAILED) {
+            close(fd);
+            madvise(region, info.st_size, MADV_SEQUENTIAL);
+            Source source;
+            source.data = static_cast<const char*>(region);
+            source.size = info.st_size;
+            source.mapped = true;
+            return source;
+        }
+    }
+
+    // not a regular file or mmap isn't supported by the file system
+    try {
+        auto source = fromDescriptor(fd);
+        close(fd);
+        return source;
+    } catch (...) {
+        close(fd);
+        throw;
+    }
+}
+
+Source Source::fromDescriptor(int fd) {
+    std::string text;
+    char chunk[64 * 1024];
+    while (true) {
+        auto count = read(fd, chunk, sizeof(chunk));
+        if (count == 0) break;
+        if (count < 0) {
+            if (errno == EINTR) continue;
+            throw std::runtime_error("Failed to read program text");
+        }
+        text.append(chunk, count);
+    }
+    return Source(std::move(text));
+}
+
+Source Source::borrow(std::string_view text) {
+    Source source;
+    source.data = text.data();
+    source.size = text.size();
+    return source;
+}
@@ -0,0 +1,162 @@
+#include "StreamingLexer.h"
+#include "Scan.h"
+#include "Utils.h"
+#include <algorithm>
+#include <cerrno>
+#include <stdexcept>
+#include <unistd.h>
+
+StreamingLexer::StreamingLexer(int fd, std::size_t chunkSize) : fd(fd), chunkSize(std::max<std::size_t>(chunkSize, 1)) {
+    buffer.reserve(2 * this->chunkSize);
+}
+
+bool StreamingLexer::hasNext() {
+    while (true) {
+        if (position == buffer.size() && !fill()) {
+            // an unterminated comment is reported by next()
+            return comments != 0;
+        }
+
+        auto current = buffer.data() + position;
+        auto end = buffer.data() + buffer.size();
+        auto c = *current;
+        if (inLineComment) {
+            auto newline = findNewline(current, end);
+            position = newline - buffer.data();
+            inLineComment = newline == end;
+        } else if (comments != 0) {
+            if (c != '(' && c != '*') {
+                auto delimiter = findCommentDelimiter(current, end);
+                lineNumber += countNewlines(current, delimiter);
+                position = delimiter - buffer.data();
+                continue;
+            }
+            // the second half of the delimiter may be in the next chunk
+            if (position + 1 == buffer.size() && !eof) {
+                fill();
+                continue;
+            }
+            if ((c == '*' && peekNext() == ')') || (c == '(' && peekNext() == '*')) {
+                c == '*' ? comments-- : comments++;
+                position++;
+            }
+            position++;
+        } else if (isWhitespace(c)) {
+            auto token = skipWhitespace(current, end);
+            lineNumber += countNewlines(current, token);
+            position = token - buffer.data();
+        } else if (c == '-' || c == '(') {
+            if (position + 1 == buffer.size() && !eof) {
+                fill();
+                continue;
+            }
+            if (c == '-' && peekNext() == '-') {
+                inLineComment = true;
+            } else if (c == '(' && peekNext() == '*') {
+                comments = 1;
+            } else {
+                return true;
+            }
+            position += 2;
+        } else {
+            return true;
+        }
+    }
+}
+
+Token StreamingLexer::next() {
+    if (position == buffer.size() && comments != 0) {
+        Token token(Token::Kind::ERROR, "EOF in comment", lineNumber);
+        token.setSpan(consumed + position, 0);
+        comments = 0;
+        return token;
+    }
+
+    // A token may continue in the next chunk. Input is read until its end is in the buffer, only the bytes
+    // of the token are kept meanwhile, and then it is lexed once.
+    while (!tokenComplete()) fill();
+    scanned = 0;
+    afterNull = false;
+
+    lexer.program = std::string_view(buffer).substr(position);
+    lexer.offset = 0;
+    lexer.lineNumber = lineNumber;
+    auto token = lexer.next();
+    token.setSpan(consumed + position + token.getOffset(), token.getLength());
+    position += lexer.offset;
+    lineNumber = lexer.lineNumber;
+    return token;
+}
+
+// Whether the token at position ends within the buffer, so that lexing it doesn't look past the end.
+// Identifiers and numbers are taken to run to the end of their letters, digits and underscores, which is
+// never shorter than the token the lexer finds.
+bool StreamingLexer::tokenComplete() {
+    if (eof) return true;
+    auto token = std::string_view(buffer).substr(position);
+    if (token.empty()) return false;
+    auto c = token[0];
+    if (c == '"') return stringComplete(token);
+    if (isAlphaOdDigitOrUnderscore(c)) {
+        auto i = std::max<std::size_t>(scanned, 1);
+        while (i < token.size() && isAlphaOdDigitOrUnderscore(token[i])) i++;
+        scanned = i;
+        return i < token.size();
+    }
+    // "=>", "<-", "<=" and "*)" are the only tokens of two characters
+    if (c == '=' || c == '<' || c == '*') return token.size() > 1;
+    return true;
+}
+
+// Follows Lexer::string: the constant ends after an unescaped quote or newline, right after a backslash
+// before a null character, and after a null character at the next quote or before the next newline
+bool StreamingLexer::stringComplete(std::string_view token) {
+    auto i = std::max<std::size_t>(scanned, 1);
+    while (i < token.size()) {
+        auto c = token[i];
+        if (afterNull) {
+            if (c == '"' || c == '\n') return true;
+        } else if (c == '"' || c == '\n') {
+            return true;
+        } else if (c == '\\') {
+            if (i + 1 == token.size()) break;
+            auto next = token[i + 1];
+            if (next == '\0') return true;
+            // an escaped quote, newline or backslash doesn't end the constant, others are read as usual
+            if (next == '"' || next == '\n' || next == '\\') i++;
+        } else if (c == '\0') {
+            afterNull = true;
+        }
+        i++;
+    }
+    scanned = i;
+    return false;
+}
+
+// Drops consumed input and appends the next chunk. Returns false if there is no more input
+bool StreamingLexer::fill() {
+    if (eof) return false;
+
+    buffer.erase(0, position);
+    consumed += position;
+    position = 0;
+
+    auto size = buffer.size();
+    buffer.resize(size + chunkSize);
+    ssize_t count;
+    do {
+        count = read(fd, &buffer[size], chunkSize);
+    } while (count < 0 && errno == EINTR);
+    if (count < 0) {
+        buffer.resize(size);
+        throw std::runtime_error("Failed to read program text");
+    }
+    buffer.resize(size + count);
+    eof = count == 0;
+    return !eof;
+}
+
+char StreamingLexer::peekNext() {
+    if (position + 1 >= buffer.size()) return '\0';
+    return buffer[position + 1];
+}
@@ -1,6 +1,7 @@
 #include "Token.h"
+#include <charconv>
 
-std::string asString(Token::Kind kind) {
+std::string_view asString(Token::Kind kind) {
     switch (kind) {
         case Token::Kind::CLASS: return "CLASS";
         case Token::Kind::ELSE: return "ELSE";
@@ -33,14 +34,36 @@ std::string asString(Token::Kind kind) {
     }
 }
 
-std::string Token::toString() {
+std::string Token::toString() const {
+    std::string result;
+    appendTo(result);
+    return result;
+}
+
+void Token::appendTo(std::string& out) const {
+    format(out, kind, getLexeme(), line);
+}
+
+void Token::format(std::string& out, Kind kind, std::string_view lexeme, std::size_t line) {
+    char digits[20];
+    auto lineEnd = std::to_chars(digits, digits + sizeof(digits), line).ptr;
+    out += '#';
+    out.append(digits, lineEnd - digits);
     if (kind == Kind::ATOM) {
-        return "#" + std::to_string(line) + " '" + lexeme + "'";
-    } else if (kind == Kind::ERROR) {
-        return "#" + std::to_string(line) + " " + asString(kind) + " \"" + lexeme + "\"";
-    } else if (lexeme.empty()) {
-        return "#" + std::to_string(line) + " " + asString(kind);
-    } else {
-        return "#" + std::to_string(line) + " " + asString(kind) + " " + lexeme;
+        out += " '";
+        out += lexeme;
+        out += '\'';
+        return;
+    }
+
+    out += ' ';
+    out += asString(kind);
+    if (kind == Kind::ERROR) {
+        out += " \"";
+        out += lexeme;
+        out += '"';
+    } else if (!lexeme.empty()) {
+        out += ' ';
+        out += lexeme;
     }
 }
@@ -0,0 +1,50 @@
+#include "TokenBuffer.h"
+#include <algorithm>
+
+void TokenBuffer::reserve(std::size_t capacity) {
+    kinds.reserve(capacity);
+    offsets.reserve(capacity);
+    lengths.reserve(capacity);
+    lines.reserve(capacity);
+}
+
+void TokenBuffer::push(Token::Kind kind, std::size_t offset, std::size_t length, std::size_t line) {
+    kinds.push_back(kind);
+    offsets.push_back(static_cast<std::uint32_t>(offset));
+    lengths.push_back(static_cast<std::uint32_t>(length));
+    lines.push_back(static_cast<std::uint32_t>(line));
+}
+
+void TokenBuffer::pushOwned(Token::Kind kind, std::size_t offset, std::size_t length, std::size_t line,
+                            std::string_view lexeme) {
+    ownedIndices.push_back(static_cast<std::uint32_t>(size()));
+    ownedLexemes.emplace_back(lexeme);
+    push(kind, offset, length, line);
+}
+
+std::string_view TokenBuffer::lexeme(std::size_t i) const {
+    switch (kinds[i]) {
+        case Token::Kind::ATOM:
+        case Token::Kind::TYPEID:
+        case Token::Kind::OBJECTID:
+        case Token::Kind::INT_CONST:
+            return program.substr(offsets[i], lengths[i]);
+        case Token::Kind::BOOL_CONST:
+            return (program[offsets[i]] | 0x20) == 't' ? "true" : "false";
+        case Token::Kind::STR_CONST:
+        case Token::Kind::ERROR: {
+            auto owned = std::lower_bound(ownedIndices.begin(), ownedIndices.end(), i);
+            if (owned != ownedIndices.end() && *owned == i) return ownedLexemes[owned - ownedIndices.begin()];
+            return program.substr(offsets[i], lengths[i]);
+        }
+        default:
+            // keywords have no lexeme
+            return {};
+    }
+}
+
+Token TokenBuffer::token(std::size_t i) const {
+    Token token = kinds[i] == Token::Kind::ATOM ? Token(lexeme(i), lines[i]) : Token(kinds[i], lexeme(i), lines[i]);
+    token.setSpan(offsets[i], lengths[i]);
+    return token;
+}
@@ -0,0 +1,180 @@
+#include "TokenWriter.h"
+#include <algorithm>
+#include <cerrno>
+#include <charconv>
+#include <cstdint>
+#include <stdexcept>
+#include <unistd.h>
+
+namespace {
+    // Lexemes of strings and errors are printed with escapes (see Lexer::string), the binary format stores
+    // the characters themselves. Octal escapes have 3 digits, or 11 for the negative chars above 127.
+    void appendUnescaped(std::string& out, std::string_view text) {
+        for (std::size_t i = 0; i < text.size(); i++) {
+            if (text[i] != '\\' || i + 1 == text.size()) {
+                out += text[i];
+                continue;
+            }
+            auto c = text[++i];
+            switch (c) {
+                case 'n': out += '\n'; break;
+                case 't': out += '\t'; break;
+                case 'b': out += '\b'; break;
+                case 'f': out += '\f'; break;
+                default:
+                    if (c < '0' || c > '7') {
+                        out += c;
+                        break;
+                    }
+                    auto digits = std::min<std::size_t>(c == '0' ? 3 : 11, text.size() - i);
+                    unsigned long value = 0;
+                    std::from_chars(text.data() + i, text.data() + i + digits, value, 8);
+                    out += static_cast<char>(value & 0xFF);
+                    i += digits - 1;
+            }
+        }
+    }
+}
+
+TokenWriter::TokenWriter(int fd, Format format, std::size_t capacity) : fd(fd), format(format), capacity(capacity) {
+    buffer.reserve(capacity + 1024);
+}
+
+TokenWriter::TokenWriter(Format format) : fd(-1), format(format), capacity(SIZE_MAX) {}
+
+TokenWriter::~TokenWriter() {
+    try {
+        flush();
+    } catch (const std::runtime_error&) {
+        // nothing to report to from a destructor, e.g. the reader of a pipe has gone
+    }
+}
+
+void TokenWriter::writeName(std::string_view fileName) {
+    auto slash = fileName.find_last_of('/');
+    if (slash != std::string_view::npos) fileName.remove_prefix(slash + 1);
+
+    if (format == Format::BINARY) {
+        buffer += static_cast<char>(TokenStream::SECTION);
+        buffer.append(TokenStream::MAGIC, sizeof(TokenStream::MAGIC));
+        buffer += static_cast<char>(TokenStream::VERSION);
+        TokenStream::appendVarint(buffer, fileName.size());
+        buffer += fileName;
+        lastLine = 0;
+        for (auto& space : interned) space.clear();
+        internedText.clear();
+        flushIfFull();
+        return;
+    }
+
+    // quoted like std::filesystem::path is by operator<<
+    buffer += "#name \"";
+    for (auto c : fileName) {
+        if (c == '"' || c == '\\') buffer += '\\';
+        buffer += c;
+    }
+    buffer += "\"\n";
+    flushIfFull();
+}
+
+void TokenWriter::write(const Token& token) {
+    onToken(token.getKind(), token.getLexeme(), token.getOffset(), token.getLength(), token.getLine());
+}
+
+void TokenWriter::onToken(Token::Kind kind, std::string_view lexeme, std::size_t, std::size_t, std::size_t line) {
+    if (format == Format::BINARY) {
+        writeBinary(kind, lexeme, line);
+    } else {
+        Token::format(buffer, kind, lexeme, line);
+        buffer += '\n';
+    }
+    flushIfFull();
+}
+
+void TokenWriter::onError(std::string_view message, std::size_t offset, std::size_t length, std::size_t line) {
+    onToken(Token::Kind::ERROR, message, offset, length, line);
+}
+
+void TokenWriter::writeBinary(Token::Kind kind, std::string_view lexeme, std::size_t line) {
+    if (kind == Token::Kind::ATOM) {
+        buffer += lexeme.front();
+    } else {
+        buffer += static_cast<char>(TokenStream::KIND_BASE + TokenStream::parserCode(kind) - TokenStream::FIRST_PARSER_CODE);
+    }
+    // lines of a file never decrease
+    TokenStream::appendVarint(buffer, line - lastLine);
+    lastLine = line;
+
+    switch (kind) {
+        case Token::Kind::TYPEID:
+        case Token::Kind::OBJECTID:
+            writeInterned(TokenStream::IDENTIFIERS, lexeme);
+            break;
+        case Token::Kind::INT_CONST:
+            writeInterned(TokenStream::INTEGERS, lexeme);
+            break;
+        case Token::Kind::STR_CONST: {
+            std::string value;
+            appendUnescaped(value, lexeme.substr(1, lexeme.size() - 2));
+            writeInterned(TokenStream::STRINGS, value);
+            break;
+        }
+        case Token::Kind::BOOL_CONST:
+            buffer += static_cast<char>(lexeme == "true");
+            break;
+        case Token::Kind::ERROR: {
+            std::string message;
+            appendUnescaped(message, lexeme);
+            TokenStream::appendVarint(buffer, message.size());
+            buffer += message;
+            break;
+        }
+        default:
+            break;
+    }
+}
+
+void TokenWriter::writeInterned(TokenStream::Space space, std::string_view text) {
+    auto& ids = interned[space];
+    auto found = ids.find(text);
+    if (found != ids.end()) {
+        TokenStream::appendVarint(buffer, found->second);
+        return;
+    }
+
+    auto id = ids.size();
+    ids.emplace(internedText.emplace_back(text), id);
+    TokenStream::appendVarint(buffer, id);
+    TokenStream::appendVarint(buffer, text.size());
+    buffer += text;
+}
+
+void TokenWriter::append(std::string_view text) {
+    if (buffer.size() + text.size() > capacity) flush();
+    if (fd >= 0 && text.size() >= capacity) {
+        // too large to be worth copying into the buffer
+        buffer = text;
+        flush();
+        return;
+    }
+    buffer += text;
+}
+
+void TokenWriter::flushIfFull() {
+    if (buffer.size() >= capacity) flush();
+}
+
+void TokenWriter::flush() {
+    if (fd < 0) return;
+    std::size_t written = 0;
+    while (written < buffer.size()) {
+        auto count = ::write(fd, buffer.data() + written, buffer.size() - written);
+        if (count < 0) {
+            if (errno == EINTR) continue;
+            buffer.clear();
+            throw std::runtime_error("Failed to write tokens");
+        }
+        written += count;
+    }
+    buffer.clear();
+}
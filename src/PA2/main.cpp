@@ -1,32 +1,156 @@
 #include "Lexer.h"
-#include <iostream>
+#include "StreamingLexer.h"
+#include "TokenWriter.h"
+#include <atomic>
+#include <condition_variable>
 #include <fstream>
-#include <filesystem>
+#include <iostream>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <unistd.h>
 
 using namespace std;
 
+void lexFile(const std::string& fileName, TokenWriter& writer) {
+    if (fileName == "-") {
+        // standard input is usually a pipe of unknown size, so it is lexed in constant memory
+        auto lexer = StreamingLexer(STDIN_FILENO);
+        writer.writeName(fileName);
+        while (lexer.hasNext()) {
+            writer.write(lexer.next());
+        }
+        return;
+    }
+
+    auto lexer = Lexer(Source::fromFile(fileName));
+    writer.writeName(fileName);
+    lexer.lex(writer);
+}
+
+struct Job {
+    std::string output;
+    std::string error;
+    bool done = false;
+};
+
+// Files are lexed on a pool of threads, each into its own buffer. The main thread prints every file as
+// soon as it and all files before it are done, so the output is the same as lexing them one by one.
+int lexConcurrently(const std::vector<std::string>& fileNames, std::size_t threadCount, TokenWriter::Format format) {
+    std::vector<Job> jobs(fileNames.size());
+    std::mutex mutex;
+    std::condition_variable finished;
+    std::atomic<std::size_t> nextJob{0};
+
+    auto work = [&]() {
+        for (auto i = nextJob++; i < jobs.size(); i = nextJob++) {
+            std::string output;
+            std::string error;
+            try {
+                TokenWriter writer(format);
+                lexFile(fileNames[i], writer);
+                output = writer.release();
+            } catch (const std::runtime_error& e) {
+                error = e.what();
+            }
+
+            std::lock_guard<std::mutex> lock(mutex);
+            jobs[i].output = std::move(output);
+            jobs[i].error = std::move(error);
+            jobs[i].done = true;
+            finished.notify_all();
+        }
+    };
+
+    std::vector<std::thread> workers;
+    for (std::size_t i = 0; i < std::min(threadCount, jobs.size()); i++) {
+        workers.emplace_back(work);
+    }
+
+    auto status = 0;
+    auto writer = TokenWriter(STDOUT_FILENO, format);
+    for (auto& job : jobs) {
+        std::string output;
+        std::string error;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            finished.wait(lock, [&job]() { return job.done; });
+            output = std::move(job.output);
+            error = std::move(job.error);
+        }
+        if (!error.empty()) {
+            writer.flush();
+            cerr << error << endl;
+            status = 1;
+        }
+        writer.append(output);
+    }
+    writer.flush();
+
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    return status;
+}
+
+// One file name per line, blank lines are skipped
+std::vector<std::string> readManifest(const std::string& manifestName) {
+    ifstream manifest(manifestName);
+    if (!manifest.is_open()) {
+        throw std::runtime_error("File " + manifestName + " wasn't found");
+    }
+
+    std::vector<std::string> fileNames;
+    std::string line;
+    while (std::getline(manifest, line)) {
+        if (!line.empty()) fileNames.push_back(line);
+    }
+    return fileNames;
+}
+
 int main(int argc, char** argv) {
     if (argc == 1) {
-        cerr << "Usage: cool_lexer [file.cl]" << endl;
+        cerr << "Usage: cool_lexer [-j threads] [--format=text|binary] (file.cl | @manifest | -)..." << endl;
         return 1;
     }
 
-    auto fileName = argv[1];
-    ifstream file(fileName);
+    std::size_t threadCount = std::max(1u, std::thread::hardware_concurrency());
+    auto format = TokenWriter::Format::TEXT;
+    std::vector<std::string> fileNames;
+    try {
+        for (int i = 1; i < argc; i++) {
+            auto argument = std::string(argv[i]);
+            if (argument == "-j" && i + 1 < argc) {
+                threadCount = std::max(1, std::stoi(argv[++i]));
+            } else if (argument == "--format=text") {
+                format = TokenWriter::Format::TEXT;
+            } else if (argument == "--format=binary") {
+                format = TokenWriter::Format::BINARY;
+            } else if (argument.rfind("--format=", 0) == 0) {
+                throw std::runtime_error("Unknown token format " + argument.substr(9));
+            } else if (argument.size() > 1 && argument[0] == '@') {
+                auto listed = readManifest(argument.substr(1));
+                fileNames.insert(fileNames.end(), listed.begin(), listed.end());
+            } else {
+                fileNames.push_back(argument);
+            }
+        }
+    } catch (const std::exception& e) {
+        cerr << e.what() << endl;
+        return 1;
+    }
 
-    if (file.is_open()) {
-        stringstream buffer;
-        buffer << file.rdbuf();
-        file.close();
+    if (fileNames.size() > 1) {
+        return lexConcurrently(fileNames, threadCount, format);
+    }
 
-        auto lexer = Lexer(buffer.str());
-        cout << "#name " << std::filesystem::path(fileName).filename() << endl;
-        while (lexer.hasNext()) {
-            cout << lexer.next().toString() << endl;
-        }
-    } else {
-        cerr << "File " << fileName << " wasn't found" << endl;
+    try {
+        auto writer = TokenWriter(STDOUT_FILENO, format);
+        if (!fileNames.empty()) lexFile(fileNames.front(), writer);
+        writer.flush();
+    } catch (const std::runtime_error& e) {
+        cerr << e.what() << endl;
         return 1;
     }
     return 0;
-}
\ No newline at end of file
+}
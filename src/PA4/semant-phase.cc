@@ -6,14 +6,23 @@ FILE *ast_file = stdin;       // we read the AST from standard input
 extern int ast_yyparse(void); // entry point to the AST parser
 
 int cool_yydebug;     // not used, but needed to link with handle_flags
+extern int memory_stats;      // print the memory used by the phase
 char *curr_filename;
 
 void handle_flags(int argc, char *argv[]);
 
 int main(int argc, char *argv[]) {
   handle_flags(argc,argv);
+  // the tree, and the nodes semant adds, are in an arena the program frees
+  Arena *arena = new Arena;
+  set_ast_arena(arena);
   ast_yyparse();
+  ast_root->set_arena(arena);
   ast_root->semant();
   ast_root->dump_with_types(cout,0);
+  if (memory_stats) {
+    print_stringtab_stats(cerr);
+    ast_root->print_stats(cerr);
+  }
 }
 
@@ -0,0 +1,86 @@
+//
+// Stress test of the string tables: writers intern the same names concurrently
+// while a reader walks the table with first/more/next.  Every index the reader
+// sees must resolve to a stored entry with that index, and every writer must get
+// the same entry for a name.  Run it from a -fsanitize=thread build to check
+// the memory ordering as well.
+//
+#include <stdio.h>
+#include <stdlib.h>
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+#include "cool-parse.h"
+#include "stringtab.h"
+
+YYSTYPE cool_yylval;            // for utilities.cc, the parser isn't linked
+
+static const int WRITERS = 8;
+static const int NAMES = 20000;
+
+static void fail(const char *what, int i)
+{
+  fprintf(stderr, "%s: %d\n", what, i);
+  exit(1);
+}
+
+static std::string name(int i)
+{
+  return "name" + std::to_string(i);
+}
+
+int main()
+{
+  std::vector<std::vector<Symbol> > got(WRITERS, std::vector<Symbol>(NAMES));
+  std::vector<std::thread> writers;
+  for (int w = 0; w < WRITERS; w++)
+    writers.emplace_back([&got, w] {
+      // each writer adds the names in its own order
+      for (int k = 0; k < NAMES; k++) {
+        int i = (k * 7 + w * 131) % NAMES;
+        std::string s = name(i);
+        got[w][i] = idtable.add_string((char *) s.c_str());
+        if (idtable.lookup_string((char *) s.c_str()) != got[w][i])
+          fail("lookup_string differs from add_string", i);
+        inttable.add_int(i % 1000);
+      }
+    });
+
+  std::atomic<bool> done(false);
+  std::thread reader([&done] {
+    while (!done)
+      for (int i = idtable.first(); idtable.more(i); i = idtable.next(i)) {
+        Symbol e = idtable.lookup(i);
+        if (!e->equal_index(i) || e->get_len() < 5)
+          fail("reader saw a bad entry", i);
+      }
+  });
+
+  for (auto &writer : writers)
+    writer.join();
+  done = true;
+  reader.join();
+
+  for (int w = 1; w < WRITERS; w++)
+    for (int i = 0; i < NAMES; i++)
+      if (got[w][i] != got[0][i])
+        fail("writers got different entries for name", i);
+
+  // every name once, at the index it was given
+  std::vector<char> seen(NAMES);
+  int count = 0;
+  for (int i = idtable.first(); idtable.more(i); i = idtable.next(i), count++) {
+    Symbol e = idtable.lookup(i);
+    if (!e->equal_index(i))
+      fail("entry has another index", i);
+    int n = atoi(e->get_string() + 4);
+    if (name(n) != e->get_string() || seen[n]++)
+      fail("unexpected entry", i);
+  }
+  if (count != NAMES)
+    fail("wrong number of entries", count);
+  if (!inttable.more(999) || inttable.more(1000))
+    fail("wrong number of integers", 1000);
+  return 0;
+}
@@ -0,0 +1,89 @@
+//
+// Round trip of the binary token stream: the tokens "cool_lexer --format=binary"
+// writes, read back by the parser front end (src/PA3/token-reader.cc) and dumped
+// as the text format, must be what "cool_lexer --format=text" prints.
+//
+//   token_reader_test cool_lexer file.cool...
+//
+#include <stdio.h>
+#include <string>
+#include <sstream>
+#include "cool-io.h"
+#include "cool-parse.h"
+#include "stringtab.h"
+#include "utilities.h"
+
+FILE *token_file = stdin;
+char *curr_filename = "<stdin>";
+int curr_lineno;
+int verbose_flag;
+YYSTYPE cool_yylval;
+
+int read_token();
+void dump_cool_token(ostream& out, int lineno, int token, YYSTYPE yylval);
+
+static std::string run(const std::string& command)
+{
+  std::string out;
+  FILE *f = popen(command.c_str(), "r");
+  char buffer[4096];
+  for (size_t n; f && (n = fread(buffer, 1, sizeof(buffer), f)) > 0; )
+    out.append(buffer, n);
+  if (!f || pclose(f) != 0) {
+    cerr << "failed: " << command << endl;
+    exit(1);
+  }
+  return out;
+}
+
+int main(int argc, char *argv[])
+{
+  if (argc < 3) {
+    cerr << "usage: token_reader_test cool_lexer file.cool..." << endl;
+    return 2;
+  }
+  std::string command = argv[1];
+  for (int i = 2; i < argc; i++)
+    command += std::string(" '") + argv[i] + "'";
+  std::string text = run(command + " --format=text");
+
+  // the reader only sees the name of a file with tokens in it
+  std::istringstream lines(text);
+  std::string expected, name;
+  for (std::string line; getline(lines, line); ) {
+    if (line.compare(0, 6, "#name ") == 0)
+      name = line + "\n";
+    else {
+      expected += name + line + "\n";
+      name.clear();
+    }
+  }
+
+  token_file = popen((command + " --format=binary").c_str(), "r");
+  std::ostringstream read;
+  char *filename = curr_filename;
+  for (int token; (token = read_token()) != 0; ) {
+    if (curr_filename != filename) {
+      read << "#name \"" << curr_filename << "\"\n";
+      filename = curr_filename;
+    }
+    dump_cool_token(read, curr_lineno, token, cool_yylval);
+  }
+  if (pclose(token_file) != 0) {
+    cerr << "failed: " << command << " --format=binary" << endl;
+    return 1;
+  }
+
+  // report the first line that differs
+  std::istringstream want(expected), got(read.str());
+  std::string w, g;
+  for (int line = 1; ; line++) {
+    bool more_w = (bool) getline(want, w), more_g = (bool) getline(got, g);
+    if (!more_w && !more_g)
+      return 0;
+    if (w != g || more_w != more_g) {
+      cerr << "line " << line << ": expected \"" << w << "\", read \"" << g << "\"" << endl;
+      return 1;
+    }
+  }
+}